@@ -0,0 +1,319 @@
+// Набор микробенчмарков для collision_detector::FindGatherEvents.
+//
+// Сценарии перебирают число собирателей и предметов, расположение предметов
+// (равномерное, кучками или на осях дорог) и движение собирателей (двигаются или стоят на месте).
+// Для каждого сценария и реализации поиска выводятся ns/pair, events/sec и число выделений
+// памяти на вызов. С ключом --csv <file> результаты дополнительно пишутся в CSV,
+// который удобно сравнивать между коммитами.
+//
+// Использование: collision_detector_bench [--csv <file>] [--repetitions <n>] [--filter <substring>]
+
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "collision_detector.h"
+
+namespace {
+
+std::atomic<size_t> allocations_count{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+    allocations_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+using namespace std::literals;
+
+class BenchProvider final : public collision_detector::ItemGathererProvider {
+   public:
+    size_t ItemsCount() const override {
+        return items_.size();
+    }
+
+    collision_detector::Item GetItem(size_t idx) const override {
+        return items_[idx];
+    }
+
+    size_t GatherersCount() const override {
+        return gatherers_.size();
+    }
+
+    collision_detector::Gatherer GetGatherer(size_t idx) const override {
+        return gatherers_[idx];
+    }
+
+    void AddItem(collision_detector::Item item) {
+        items_.push_back(std::move(item));
+    }
+
+    void AddGatherer(collision_detector::Gatherer gatherer) {
+        gatherers_.push_back(gatherer);
+    }
+
+   private:
+    std::vector<collision_detector::Item> items_;
+    std::vector<collision_detector::Gatherer> gatherers_;
+};
+
+// Простой пул потоков для FindGatherEventsParallel
+class WorkerPool {
+   public:
+    explicit WorkerPool(unsigned threads) {
+        for (unsigned i = 0; i < threads; ++i) {
+            workers_.emplace_back([this](std::stop_token stop) {
+                Run(stop);
+            });
+        }
+    }
+
+    void Post(std::function<void()> task) {
+        {
+            std::lock_guard lock{mutex_};
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+   private:
+    void Run(std::stop_token stop) {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock{mutex_};
+                if (!cv_.wait(lock, stop, [&] {
+                        return !tasks_.empty();
+                    })) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::jthread> workers_;
+};
+
+enum class Placement {
+    UNIFORM,
+    CLUSTERED,
+    // Предметы на осях дорог, проложенных по целым координатам, как в игре
+    ROADS
+};
+
+enum class Motion {
+    MOVING,
+    STATIONARY
+};
+
+struct Scenario {
+    size_t gatherers;
+    size_t items;
+    Placement placement;
+    Motion motion;
+
+    std::string Name() const {
+        const char* placement_names[] = {"/uniform", "/clustered", "/roads"};
+        return std::to_string(gatherers) + "x"s + std::to_string(items) +
+               placement_names[static_cast<int>(placement)] +
+               (motion == Motion::MOVING ? "/moving"s : "/stationary"s);
+    }
+};
+
+// Плотность предметов постоянна: сторона поля растёт как корень из их числа
+BenchProvider MakeScene(const Scenario& scenario) {
+    std::mt19937 generator{2024};
+    const double side = 2.0 * std::sqrt(static_cast<double>(scenario.items));
+    std::uniform_real_distribution<double> coord{0.0, side};
+    std::normal_distribution<double> spread{0.0, 3.0};
+    std::uniform_real_distribution<double> length{0.5, 3.0};
+    std::bernoulli_distribution horizontal{0.5};
+
+    std::vector<geom::Point2D> clusters;
+    for (size_t c = 0; c < std::max<size_t>(scenario.items / 500, 1); ++c) {
+        clusters.emplace_back(coord(generator), coord(generator));
+    }
+    auto random_point = [&]() -> geom::Point2D {
+        if (scenario.placement == Placement::UNIFORM) {
+            return {coord(generator), coord(generator)};
+        }
+        if (scenario.placement == Placement::ROADS) {
+            geom::Point2D point{coord(generator), coord(generator)};
+            double& across = horizontal(generator) ? point.y : point.x;
+            across = std::round(across);
+            return point;
+        }
+        const auto& center = clusters[generator() % clusters.size()];
+        return {center.x + spread(generator), center.y + spread(generator)};
+    };
+
+    BenchProvider provider;
+    for (size_t i = 0; i < scenario.items; ++i) {
+        provider.AddItem({random_point(), 0.0});
+    }
+    for (size_t g = 0; g < scenario.gatherers; ++g) {
+        const geom::Point2D start = random_point();
+        geom::Point2D end = start;
+        if (scenario.motion == Motion::MOVING) {
+            (horizontal(generator) ? end.x : end.y) += length(generator);
+        }
+        provider.AddGatherer({start, end, 0.3});
+    }
+    return provider;
+}
+
+struct Measurement {
+    double ns_per_call;
+    size_t events;
+    double allocations_per_call;
+};
+
+template <typename Fn>
+Measurement Measure(Fn&& fn, int repetitions) {
+    std::vector<double> samples;
+    size_t events = 0;
+    size_t allocations = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        const size_t allocations_before = allocations_count.load();
+        const auto start = std::chrono::steady_clock::now();
+        events = fn().size();
+        const auto finish = std::chrono::steady_clock::now();
+        allocations += allocations_count.load() - allocations_before;
+        samples.push_back(std::chrono::duration<double, std::nano>(finish - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return {samples[samples.size() / 2], events, static_cast<double>(allocations) / repetitions};
+}
+
+struct Args {
+    std::optional<std::string> csv_path;
+    int repetitions = 5;
+    std::string filter;
+};
+
+std::optional<Args> ParseArgs(int argc, const char* argv[]) {
+    Args args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            return std::nullopt;
+        }
+        if (arg == "--csv"sv) {
+            args.csv_path = argv[++i];
+        } else if (arg == "--repetitions"sv) {
+            args.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--filter"sv) {
+            args.filter = argv[++i];
+        } else {
+            return std::nullopt;
+        }
+    }
+    return args;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    const auto args = ParseArgs(argc, argv);
+    if (!args) {
+        std::cerr << "Usage: " << argv[0] << " [--csv <file>] [--repetitions <n>] [--filter <substring>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Scenario> scenarios;
+    for (auto [gatherers, items] : {std::pair<size_t, size_t>{10, 100}, {100, 1'000}, {1'000, 10'000}}) {
+        for (auto placement : {Placement::UNIFORM, Placement::CLUSTERED, Placement::ROADS}) {
+            for (auto motion : {Motion::MOVING, Motion::STATIONARY}) {
+                scenarios.push_back({gatherers, items, placement, motion});
+            }
+        }
+    }
+
+    WorkerPool pool{std::max(1u, std::thread::hardware_concurrency() - 1)};
+    collision_detector::ParallelGatherConfig parallel_config;
+    parallel_config.min_gatherers = 0;
+    parallel_config.gatherers_per_chunk = 64;
+
+    std::optional<std::ofstream> csv;
+    if (args->csv_path) {
+        csv.emplace(*args->csv_path);
+        *csv << "scenario,algorithm,gatherers,items,ns_per_call,ns_per_pair,events,events_per_sec,allocations_per_call\n";
+    }
+
+    std::cout << std::left << std::setw(36) << "scenario" << std::setw(14) << "algorithm" << std::right
+              << std::setw(14) << "ns/pair" << std::setw(10) << "events" << std::setw(16) << "events/sec"
+              << std::setw(14) << "allocs/call" << std::endl;
+
+    for (const auto& scenario : scenarios) {
+        const BenchProvider provider = MakeScene(scenario);
+        const collision_detector::ItemGathererProvider& virtual_provider = provider;
+        const std::vector<std::pair<std::string, std::function<std::vector<collision_detector::GatheringEvent>()>>> algorithms{
+            {"brute_force", [&] { return collision_detector::FindGatherEvents(provider); }},
+            {"virtual", [&] { return collision_detector::FindGatherEvents(virtual_provider); }},
+            {"grid", [&] { return collision_detector::FindGatherEventsGrid(provider); }},
+            {"sweep", [&] { return collision_detector::FindGatherEventsSweep(provider); }},
+            {"parallel", [&] {
+                 return collision_detector::FindGatherEventsParallel(
+                     provider, [&pool](std::function<void()> task) { pool.Post(std::move(task)); }, parallel_config);
+             }},
+        };
+
+        for (const auto& [algorithm, fn] : algorithms) {
+            const std::string name = scenario.Name();
+            if (!args->filter.empty() && (name + "/"s + algorithm).find(args->filter) == std::string::npos) {
+                continue;
+            }
+            const auto m = Measure(fn, args->repetitions);
+            const double pairs = static_cast<double>(scenario.gatherers) * scenario.items;
+            const double ns_per_pair = m.ns_per_call / pairs;
+            const double events_per_sec = m.events / (m.ns_per_call * 1e-9);
+
+            std::cout << std::left << std::setw(36) << name << std::setw(14) << algorithm << std::right
+                      << std::setw(14) << std::setprecision(4) << ns_per_pair << std::setw(10) << m.events
+                      << std::setw(16) << std::setprecision(6) << events_per_sec << std::setw(14)
+                      << m.allocations_per_call << std::endl;
+            if (csv) {
+                *csv << name << ',' << algorithm << ',' << scenario.gatherers << ',' << scenario.items << ','
+                     << m.ns_per_call << ',' << ns_per_pair << ',' << m.events << ',' << events_per_sec << ','
+                     << m.allocations_per_call << '\n';
+            }
+        }
+    }
+}
@@ -0,0 +1,156 @@
+// Микробенчмарк model::RoadIndex::GetRoadsAtPoint.
+//
+// Запросы - целые точки на случайных дорогах, как при перемещении собак в GameSession::MoveDog.
+// Измеряются карты из конфигурационного файла и синтетические карты на 100 тысяч дорог:
+// плотная сетка кварталов и разреженная карта с далеко разнесёнными рядами.
+//
+// Использование: road_index_bench [<config.json>]
+
+#include <algorithm>
+#include <boost/json.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json_key.h"
+#include "model.h"
+
+namespace {
+
+using namespace std::literals;
+namespace json = boost::json;
+
+constexpr size_t QUERIES_COUNT = 1'000'000;
+constexpr int REPETITIONS = 5;
+
+struct NamedRoads {
+    std::string name;
+    model::Map::Roads roads;
+};
+
+std::vector<NamedRoads> LoadConfigRoads(const std::string& path) {
+    std::ifstream stream{path};
+    if (!stream) {
+        throw std::runtime_error("Failed to open file "s + path);
+    }
+    std::stringstream data;
+    data << stream.rdbuf();
+
+    std::vector<NamedRoads> result;
+    for (const auto& map : json::parse(data.str()).at(Key::MAPS).as_array()) {
+        NamedRoads named{std::string{map.at(Key::ID).as_string()}, {}};
+        for (const auto& road : map.at(Key::ROADS).as_array()) {
+            const auto& obj = road.as_object();
+            const model::Point start{static_cast<model::Coord>(obj.at(Key::X0).as_int64()),
+                                     static_cast<model::Coord>(obj.at(Key::Y0).as_int64())};
+            if (obj.contains(Key::X1)) {
+                named.roads.emplace_back(model::Road::HORIZONTAL, start,
+                                         static_cast<model::Coord>(obj.at(Key::X1).as_int64()));
+            } else {
+                named.roads.emplace_back(model::Road::VERTICAL, start,
+                                         static_cast<model::Coord>(obj.at(Key::Y1).as_int64()));
+            }
+        }
+        result.push_back(std::move(named));
+    }
+    return result;
+}
+
+// Сетка кварталов: ряды и столбцы через row_step, нарезанные на отрезки длины block
+model::Map::Roads MakeGridRoads(size_t roads_count, model::Coord row_step, model::Coord block) {
+    model::Map::Roads roads;
+    const size_t lines = 200;
+    const size_t blocks_per_line = roads_count / (2 * lines);
+    for (size_t line = 0; line < lines; ++line) {
+        const model::Coord key = static_cast<model::Coord>(line) * row_step;
+        for (size_t b = 0; b < blocks_per_line; ++b) {
+            const model::Coord start = static_cast<model::Coord>(b) * block;
+            roads.emplace_back(model::Road::HORIZONTAL, model::Point{start, key}, start + block);
+            roads.emplace_back(model::Road::VERTICAL, model::Point{key, start}, start + block);
+        }
+    }
+    return roads;
+}
+
+std::vector<model::Point> MakeQueries(const model::Map::Roads& roads) {
+    std::mt19937 generator{2024};
+    std::uniform_int_distribution<size_t> road_index{0, roads.size() - 1};
+    std::uniform_real_distribution<double> phase{0.0, 1.0};
+    std::vector<model::Point> queries;
+    queries.reserve(QUERIES_COUNT);
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+        const auto& road = roads[road_index(generator)];
+        const auto p0 = road.GetStart();
+        const auto p1 = road.GetEnd();
+        const double t = phase(generator);
+        queries.push_back({static_cast<model::Coord>(std::lround(std::lerp(p0.x, p1.x, t))),
+                           static_cast<model::Coord>(std::lround(std::lerp(p0.y, p1.y, t)))});
+    }
+    return queries;
+}
+
+template <typename Fn>
+double MedianNs(Fn&& fn) {
+    std::vector<double> samples;
+    for (int i = 0; i < REPETITIONS; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto finish = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(finish - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+void Run(const NamedRoads& named) {
+    const double build_ns = MedianNs([&] {
+        model::RoadIndex index{named.roads};
+    });
+    const model::RoadIndex index{named.roads};
+    const auto queries = MakeQueries(named.roads);
+
+    size_t found = 0;
+    const double query_ns = MedianNs([&] {
+        found = 0;
+        for (const auto& pt : queries) {
+            const auto roads = index.GetRoadsAtPoint(pt);
+            found += roads.horizontal.has_value() + roads.vertical.has_value();
+        }
+    });
+
+    std::cout << std::left << std::setw(20) << named.name << std::right << std::setw(10) << named.roads.size()
+              << std::setw(14) << std::setprecision(4) << build_ns / 1e6 << std::setw(14)
+              << query_ns / queries.size() << std::setw(12) << found << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [<config.json>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<NamedRoads> maps;
+    try {
+        maps = LoadConfigRoads(argc == 2 ? argv[1] : "data/config.json");
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    maps.push_back({"synthetic/dense", MakeGridRoads(100'000, 10, 10)});
+    maps.push_back({"synthetic/sparse", MakeGridRoads(100'000, 100'000, 10)});
+
+    std::cout << std::left << std::setw(20) << "map" << std::right << std::setw(10) << "roads" << std::setw(14)
+              << "build ms" << std::setw(14) << "ns/query" << std::setw(12) << "found" << std::endl;
+    for (const auto& named : maps) {
+        Run(named);
+    }
+}
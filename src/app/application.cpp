@@ -1,12 +1,15 @@
 #include "application.h"
 
+#include <algorithm>
+#include <cassert>
+#include <functional>
 #include <ranges>
 
 #include "database_invariants.h"
 #include "model_serialization.h"
 
-Application::Application(model::Game& game, bool randomize_spawn_points, net::io_context& ioc, std::optional<std::chrono::milliseconds> tick_period, std::optional<fs::path> state_file_path, std::optional<std::chrono::milliseconds> state_period, const DbConnectrioSettings& db_settings)
-    : game_{game}, joiner_{player_tokens_, players_, randomize_spawn_points}, ioc_{ioc}, tick_period_{tick_period}, state_file_path_{state_file_path}, state_period_{state_period}, db_{db_settings}, record_use_case{db_.GetPlayerRecordRepository()} {
+Application::Application(model::Game& game, bool randomize_spawn_points, net::io_context& ioc, std::optional<std::chrono::milliseconds> tick_period, size_t max_catch_up_ticks, std::optional<fs::path> state_file_path, std::optional<std::chrono::milliseconds> state_period, const DbConnectrioSettings& db_settings)
+    : game_{game}, joiner_{player_tokens_, players_, randomize_spawn_points}, ioc_{ioc}, tick_period_{tick_period}, max_catch_up_ticks_{max_catch_up_ticks}, state_file_path_{state_file_path}, state_period_{state_period}, tick_coordinator_{std::make_shared<TickCoordinator>(ioc, tick_period)}, db_{db_settings}, record_use_case{db_.GetPlayerRecordRepository()} {
 }
 
 const ListMapsUseCase::Maps& Application::ListMaps() const noexcept {
@@ -17,26 +20,43 @@ const std::shared_ptr<model::Map> Application::FindMap(const std::string& id) co
     return map_finder_.FindMap(id);
 }
 
-const GameState Application::GetGameState(const Token& token) const {
+GameState Application::GetGameState(const Token& token) const {
+    // Блокировка нужна только для поиска по токену, снимок сессии читается без неё
+    std::shared_lock lock{mutex_};
     return game_state_.GetGameState(token);
 }
 
-void Application::MovePlayer(const Token& token, MoveAction action) {
-    mover_.Move(token, action);
+MoveResult Application::MovePlayer(const Token& token, std::optional<model::Direction> direction) {
+    // Команда уходит в очередь сессии, таблицы только читаются
+    std::shared_lock lock{mutex_};
+    return mover_.Move(token, direction);
 }
 
 void Application::Tick(std::chrono::milliseconds delta) {
-    ticker_.Tick(delta);
-    static int period = state_period_
-                            ? state_period_.value().count()
-                            : 0;
-    if (!state_period_) {
-        return;
+    tick_coordinator_->Tick(delta);
+}
+
+void Application::Run() {
+    tick_coordinator_->SetBatchHandler([self = shared_from_this()](std::chrono::milliseconds delta) {
+        self->OnTickBatch(delta);
+    });
+    tick_coordinator_->Start();
+}
+
+void Application::OnTickBatch(std::chrono::milliseconds delta) {
+    // Между партиями ни одна сессия не тикает. Сохраняем до слияния, чтобы в сохранение
+    // не попали игроки, которые переходят между сессиями
+    if (state_period_ && state_file_path_ && state_file_path_->has_filename()) {
+        since_save_ += delta;
+        if (since_save_ >= state_period_.value()) {
+            SaveGame();
+            since_save_ = std::chrono::milliseconds{0};
+        }
     }
-    period -= delta.count();
-    if (period <= 0) {
-        SaveGame();
-        period = state_period_.value().count();
+    since_consolidation_ += delta;
+    if (since_consolidation_ >= CONSOLIDATION_PERIOD) {
+        ConsolidateSessions();
+        since_consolidation_ = std::chrono::milliseconds{0};
     }
 }
 
@@ -57,94 +77,68 @@ std::optional<RecordUseCase::Records> Application::GetRecords(std::optional<size
 }
 
 std::vector<PlayerInfo> Application::ListPlayers(const Token& token) const {
+    std::shared_lock lock{mutex_};
     return list_players_.ListPlayers(token);
 }
 
-std::pair<std::string, std::string> Application::JoinGame(const std::string& map_id, std::string name) {
-    auto const session = FindSessionsByMapId(model::Map::Id{map_id});
-    if (session.has_value()) {
-        return joiner_.Join(session.value(), std::move(name));
-    } else if (auto map = game_.FindMap(model::Map::Id{map_id})) {
-        auto new_session = AddSession(map);
-        auto out = joiner_.Join(new_session, std::move(name));
-        new_session->Run();
-        return out;
-    } else
-        throw std::runtime_error{"Join game Error, invalid map"};
+std::shared_ptr<GameSession> Application::SelectSessionForJoin(const std::string& map_id) {
+    std::unique_lock lock{mutex_};
+    if (auto session = FindSessionForJoin(model::Map::Id{map_id})) {
+        return *session;
+    }
+    if (auto map = game_.FindMap(model::Map::Id{map_id})) {
+        // Все сессии карты заполнены или их ещё нет
+        return AddSession(map);
+    }
+    return nullptr;
 }
 
-std::optional<std::shared_ptr<GameSession>> Application::FindSessionsByMapId(const model::Map::Id& session_map_id) const noexcept {
-    auto it_sessions_id_to_index_ = map_id_to_sessions_id_to_index_.find(session_map_id);
-    if (it_sessions_id_to_index_ != map_id_to_sessions_id_to_index_.end()) {
-        auto [map_id, sessions_id_to_index_] = *it_sessions_id_to_index_;
-        auto it_session = sessions_id_to_index_.begin();
-        if (it_session != sessions_id_to_index_.end()) {
-            return sessions_[it_session->second];
-        }
+std::optional<std::pair<std::string, std::string>> Application::JoinGame(const std::shared_ptr<GameSession>& session,
+                                                                        std::string name) {
+    assert(session->GetStrand()->running_in_this_thread());
+    std::unique_lock lock{mutex_};
+    // Между выбором сессии и входом в её strand сессию могли слить с соседней и закрыть
+    auto it_sessions = map_id_to_sessions_.find(session->GetMap()->GetId());
+    if (it_sessions == map_id_to_sessions_.end() ||
+        std::ranges::find(it_sessions->second, session) == it_sessions->second.end()) {
+        return std::nullopt;
     }
-    return std::nullopt;
+    return joiner_.Join(session, std::move(name));
 }
 
-std::shared_ptr<GameSession> Application::AddSession(const std::shared_ptr<model::Map> session_map) {
-    using namespace std::literals;
-    auto session = std::make_shared<GameSession>(session_id, session_map, game_.GetLootGeneratorConfig(), ioc_, tick_period_);
-    const size_t index = sessions_.size();
-    // if (auto [it, inserted] = session_id_to_index_.emplace(session->GetId(), index); !inserted) {
-    //     throw std::invalid_argument("Session with id "s + std::to_string(*session->GetId()) + " already exists"s);
-    // } else {
-    try {
-        sessions_.emplace_back(session);
-        auto it_sessions_id_to_index_ = map_id_to_sessions_id_to_index_.find(session_map->GetId());
-        if (it_sessions_id_to_index_ != map_id_to_sessions_id_to_index_.end()) {
-            it_sessions_id_to_index_->second.emplace(session->GetId(), index);
-        } else {
-            SessionIdToIndex session_id_to_index;
-            session_id_to_index.emplace(session->GetId(), index);
-            map_id_to_sessions_id_to_index_.emplace(session_map->GetId(), std::move(session_id_to_index));
+std::optional<std::shared_ptr<GameSession>> Application::FindSessionForJoin(const model::Map::Id& session_map_id) const noexcept {
+    auto it_sessions = map_id_to_sessions_.find(session_map_id);
+    if (it_sessions == map_id_to_sessions_.end()) {
+        return std::nullopt;
+    }
+    std::optional<std::shared_ptr<GameSession>> least_loaded;
+    size_t least_players = 0;
+    for (const auto& session : it_sessions->second) {
+        const size_t players = SessionLoad(*session);
+        if (players >= session->GetMap()->GetMaxPlayersPerSession()) {
+            continue;
+        }
+        if (!least_loaded || players < least_players) {
+            least_loaded = session;
+            least_players = players;
         }
-        *(session_id) += 1;
-    } catch (...) {
-        // session_id_to_index_.erase(it);
-        throw;
     }
-    //}
-
-    session->AddHandlingFinishedPlayersEvent(
-        [self = shared_from_this()](const std::vector<PlayerRecord>& player_records) {
-            self->CommitGameRecords(player_records);
-        });
-    session->AddRemoveInactivePlayersHandler(
-        [self = shared_from_this()](const GameSession::Id& session_id) {
-            self->RemoveInactivePlayers(session_id);
-        });
+    return least_loaded;
+}
 
+std::shared_ptr<GameSession> Application::AddSession(const std::shared_ptr<model::Map> session_map) {
+    auto session = std::make_shared<GameSession>(session_id, session_map, game_.GetLootGeneratorConfig(), ioc_, tick_period_, gather_pool_, max_catch_up_ticks_);
+    *(session_id) += 1;
+    AddSession(session);
     return session;
 }
 
 void Application::AddSession(std::shared_ptr<GameSession> session) {
-    using namespace std::literals;
     if (session->GetId() >= session_id) {
         session_id = GameSession::Id{*session->GetId() + 1};
     }
-    const size_t index = sessions_.size();
-    // if (auto [it, inserted] = session_id_to_index_.emplace(session->GetId(), index); !inserted) {
-    //     throw std::invalid_argument("Session with id "s + std::to_string(*session->GetId()) + " already exists"s);
-    // } else {
-    try {
-        sessions_.emplace_back(session);
-        auto it_sessions_id_to_index_ = map_id_to_sessions_id_to_index_.find(session->GetMap()->GetId());
-        if (it_sessions_id_to_index_ != map_id_to_sessions_id_to_index_.end()) {
-            it_sessions_id_to_index_->second.emplace(session->GetId(), index);
-        } else {
-            SessionIdToIndex session_id_to_index;
-            session_id_to_index.emplace(session->GetId(), index);
-            map_id_to_sessions_id_to_index_.emplace(session->GetMap()->GetId(), std::move(session_id_to_index));
-        }
-    } catch (...) {
-        // session_id_to_index_.erase(it);
-        throw;
-    }
-    //}
+    sessions_.emplace_back(session);
+    map_id_to_sessions_[session->GetMap()->GetId()].emplace_back(session);
 
     session->AddHandlingFinishedPlayersEvent(
         [self = shared_from_this()](const std::vector<PlayerRecord>& player_records) {
@@ -154,6 +148,7 @@ void Application::AddSession(std::shared_ptr<GameSession> session) {
         [self = shared_from_this()](const GameSession::Id& session_id) {
             self->RemoveInactivePlayers(session_id);
         });
+    tick_coordinator_->AddSession(session);
 }
 
 #include <boost/archive/text_iarchive.hpp>
@@ -162,6 +157,7 @@ void Application::AddSession(std::shared_ptr<GameSession> session) {
 #include <fstream>
 
 void Application::SaveGame() {
+    std::shared_lock lock{mutex_};
     std::vector<serialization::GameSessionRepr> sessions_repr;
     sessions_repr.reserve(sessions_.size());
     for (auto session : sessions_) {
@@ -188,17 +184,9 @@ void Application::RestoreGame() {
     else if (!state_file_path_.value().has_filename())
         return;
     if (!(fs::exists(state_file_path_.value()))) {
-        if (state_period_.has_value()) {
-            save_game_ticker_ = std::make_shared<Ticker>(
-                ioc_,
-                state_period_.value(),
-                [self = shared_from_this()](const std::chrono::milliseconds& delta_time) {
-                    self->SaveGame();
-                });
-            save_game_ticker_->Start();
-        }
         return;
     }
+    std::unique_lock lock{mutex_};
     std::vector<serialization::GameSessionRepr> sessions_repr;
     std::ifstream file1(state_file_path_.value());
     boost::archive::text_iarchive ia(file1);
@@ -206,7 +194,9 @@ void Application::RestoreGame() {
     file1.close();
     sessions_.reserve(sessions_repr.size());
     for (auto&& session_repr : sessions_repr) {
-        auto session = std::make_shared<GameSession>(GameSession::Id{*session_repr.RestoreSessionId()}, game_.FindMap(session_repr.RestoreMapId()), game_.GetLootGeneratorConfig(), ioc_, tick_period_);
+        auto session = std::make_shared<GameSession>(GameSession::Id{*session_repr.RestoreSessionId()}, game_.FindMap(session_repr.RestoreMapId()), game_.GetLootGeneratorConfig(), ioc_, tick_period_, gather_pool_, max_catch_up_ticks_);
+        // Снимок восстановленной сессии публикуется один раз, когда в неё вернутся все псы и предметы
+        GameSession::DeferredPublish deferred_publish{*session};
 
         for (auto&& player_repr : session_repr.GetPlayersSerialize()) {
             auto [player, token] = player_repr.Restore();
@@ -214,25 +204,14 @@ void Application::RestoreGame() {
             player->SetSession(session);
             players_.Add(player);
             session->AddDog(player->GetDog());
+            session->SetDogOwner(player->GetDog()->GetId(), *player->GetId());
         }
 
         for (auto&& lost_object_repr : session_repr.GetLostObjectsSerialize()) {
-            auto lost_object = lost_object_repr.Restore();
-            session->AddLostObject(lost_object);
+            session->AddLostObject(lost_object_repr.Restore());
         }
 
         AddSession(session);
-        session->Run();
-    }
-
-    if (state_period_.has_value()) {
-        save_game_ticker_ = std::make_shared<Ticker>(
-            ioc_,
-            state_period_.value(),
-            [self = shared_from_this()](const std::chrono::milliseconds& delta_time) {
-                self->SaveGame();
-            });
-        save_game_ticker_->Start();
     }
 }
 
@@ -245,33 +224,181 @@ void Application::CommitGameRecords(const std::vector<PlayerRecord>& player_reco
 };
 
 void Application::RemoveInactivePlayers(const GameSession::Id& session_id) {
-    std::unordered_map<Token,
-                       Player::Id,
-                       TokenHasher>
-        token_to_player_id_for_delete;
+    // Вызывается из strand сессии во время тика
+    std::unique_lock lock{mutex_};
     auto session_players = players_.FindPlayersBySessionId(session_id).value();
 
     for (auto it = session_players.begin(); it != session_players.end(); ++it) {
-        if (!it->second->GetSession()->GetDogs().contains(it->second->GetDog()->GetId())) {
+        const auto session = it->second->GetSession();
+        if (!session->GetDogs().Contains(it->second->GetDog()->GetId())) {
             auto player_id = it->first;
-            players_.ErasePlayerFromSession(it->second->GetSession()->GetId(), player_id);
-            if (players_.FindPlayersBySessionId(session_id)->size() == 0) {
-                players_.EraseSession(it->second->GetSession()->GetId());
-                auto tmp = sessions_.begin();
-                for (auto its = sessions_.begin(); its != sessions_.end(); ++its) {
-                    if ((*its)->GetId() == it->second->GetSession()->GetId()) {
-                        tmp = its;
-                        sessions_.erase(tmp);
-                        break;
-                    }
-                }
+            players_.ErasePlayerFromSession(session->GetId(), player_id);
+            if (players_.CountPlayersInSession(session_id) == 0) {
+                RemoveSession(session);
             }
             player_tokens_.EraseTokenByPlayerId(player_id);
         }
     }
 };
 
-std::optional<std::shared_ptr<GameSession>> Application::GetSessionByToken(const Token& token) {
+void Application::ConsolidateSessions() {
+    std::vector<Transfer> transfers;
+    {
+        std::unique_lock lock{mutex_};
+        for (auto& [map_id, map_sessions] : map_id_to_sessions_) {
+            if (map_sessions.size() < 2) {
+                continue;
+            }
+            const size_t max_players = map_sessions.front()->GetMap()->GetMaxPlayersPerSession();
+            Sessions candidates = map_sessions;
+            std::ranges::sort(candidates, std::ranges::greater{}, [this](const auto& session) {
+                return SessionLoad(*session);
+            });
+            // Опустошаем сессии, начиная с наименее населённой, пока их игроки помещаются в остальные
+            while (candidates.size() > 1) {
+                const auto source = candidates.back();
+                candidates.pop_back();
+                const size_t players = players_.CountPlayersInSession(source->GetId());
+                if (players > max_players / 2 || arriving_.contains(source->GetId())) {
+                    break;
+                }
+                size_t free_places = 0;
+                for (const auto& target : candidates) {
+                    const size_t load = SessionLoad(*target);
+                    free_places += std::min(players, load < max_players ? max_players - load : 0);
+                }
+                if (free_places < players) {
+                    break;
+                }
+                // Закрытая для входа сессия доживает, пока из неё не уйдут все игроки
+                std::erase(map_sessions, source);
+                if (players == 0) {
+                    RemoveSession(source);
+                    continue;
+                }
+                Transfer transfer{source, {}};
+                for (const auto& [player_id, player] : players_.FindPlayersBySessionId(source->GetId()).value()) {
+                    // Каждого игрока - в наименее загруженную сессию, где есть место
+                    std::shared_ptr<GameSession> target;
+                    size_t target_load = 0;
+                    for (const auto& session : candidates) {
+                        const size_t load = SessionLoad(*session);
+                        if (load < max_players && (!target || load < target_load)) {
+                            target = session;
+                            target_load = load;
+                        }
+                    }
+                    ++arriving_[target->GetId()];
+                    transfer.moves.emplace_back(player, std::move(target));
+                }
+                transfers.push_back(std::move(transfer));
+            }
+        }
+    }
+    if (transfers.empty()) {
+        return;
+    }
+    // Следующая партия начнётся, когда завершится последний переход и исчезнет последняя копия hold
+    std::shared_ptr<void> hold{nullptr, [release = tick_coordinator_->HoldNextBatch()](void*) {
+                                   release();
+                               }};
+    for (auto& transfer : transfers) {
+        const auto strand = transfer.source->GetStrand();
+        net::post(*strand, [self = shared_from_this(), transfer = std::move(transfer), hold] {
+            self->ReleaseTransfer(transfer, hold);
+        });
+    }
+}
+
+void Application::ReleaseTransfer(const Transfer& transfer, std::shared_ptr<void> hold) {
+    assert(transfer.source->GetStrand()->running_in_this_thread());
+    std::vector<model::Dog::Id> dog_ids;
+    dog_ids.reserve(transfer.moves.size());
+    for (const auto& [player, target] : transfer.moves) {
+        dog_ids.push_back(player->GetDog()->GetId());
+    }
+    auto dogs = transfer.source->ReleaseDogs(dog_ids);
+
+    std::vector<Arrival> arrivals;
+    std::unique_lock lock{mutex_};
+    for (size_t i = 0; i < transfer.moves.size(); ++i) {
+        const auto& [player, target] = transfer.moves[i];
+        if (!dogs[i]) {
+            // Пёс уже ушёл из игры
+            players_.ErasePlayerFromSession(transfer.source->GetId(), player->GetId());
+            player_tokens_.EraseTokenByPlayerId(player->GetId());
+            FinishArrivals(*target, 1);
+            continue;
+        }
+        auto arrival = std::ranges::find(arrivals, target, &Arrival::target);
+        if (arrival == arrivals.end()) {
+            arrival = arrivals.insert(arrivals.end(), Arrival{target, {}, {}});
+        }
+        arrival->players.push_back(player);
+        arrival->dogs.push_back(std::move(dogs[i]));
+    }
+    if (arrivals.empty()) {
+        if (players_.CountPlayersInSession(transfer.source->GetId()) == 0) {
+            RemoveSession(transfer.source);
+        }
+        return;
+    }
+    // Счётчик меняется только под mutex_
+    auto remaining = std::make_shared<size_t>(arrivals.size());
+    for (auto& arrival : arrivals) {
+        const auto strand = arrival.target->GetStrand();
+        net::post(*strand, [self = shared_from_this(), source = transfer.source, arrival = std::move(arrival),
+                            remaining, hold] {
+            self->AdoptArrival(source, arrival, remaining);
+        });
+    }
+}
+
+void Application::AdoptArrival(const std::shared_ptr<GameSession>& source, const Arrival& arrival,
+                               std::shared_ptr<size_t> remaining) {
+    assert(arrival.target->GetStrand()->running_in_this_thread());
+    arrival.target->AdoptDogs(arrival.dogs);
+
+    std::unique_lock lock{mutex_};
+    for (const auto& player : arrival.players) {
+        players_.ErasePlayerFromSession(source->GetId(), player->GetId());
+        player->SetSession(arrival.target);
+        players_.Add(player);
+    }
+    FinishArrivals(*arrival.target, arrival.players.size());
+    if (--*remaining == 0 && players_.CountPlayersInSession(source->GetId()) == 0) {
+        RemoveSession(source);
+    }
+}
+
+size_t Application::SessionLoad(const GameSession& session) const noexcept {
+    const auto it = arriving_.find(session.GetId());
+    return players_.CountPlayersInSession(session.GetId()) + (it != arriving_.end() ? it->second : 0);
+}
+
+void Application::FinishArrivals(const GameSession& session, size_t count) {
+    const auto it = arriving_.find(session.GetId());
+    if ((it->second -= count) == 0) {
+        arriving_.erase(it);
+    }
+}
+
+void Application::RemoveSession(const std::shared_ptr<GameSession>& session) {
+    // Держим сессию живой, пока она удаляется из всех списков
+    const auto keep_alive = session;
+    if (players_.FindPlayersBySessionId(session->GetId())) {
+        players_.EraseSession(session->GetId());
+    }
+    tick_coordinator_->RemoveSession(session->GetId());
+    std::erase(map_id_to_sessions_[session->GetMap()->GetId()], session);
+    std::erase(sessions_, session);
+}
+
+std::optional<std::shared_ptr<GameSession>> Application::GetSessionByToken(const Token& token) const {
+    std::shared_lock lock{mutex_};
     auto player = player_tokens_.FindPlayerByToken(token);
+    if (!player) {
+        return std::nullopt;
+    }
     return player->GetSession();
 }
@@ -1,42 +1,94 @@
 #pragma once
 #include <filesystem>
+#include <shared_mutex>
+#include <thread>
 
 #include "database.h"
 #include "model.h"
 #include "player.h"
-#include "ticker.h"
+#include "tick_coordinator.h"
 #include "use_cases.h"
 namespace fs = std::filesystem;
 
+/*
+ * Таблицы игроков, токенов и сессий защищены mutex_: запросы на чтение берут его
+ * совместно и идут параллельно, вход игроков, удаление неактивных, слияние сессий
+ * и восстановление - монопольно. Состояние самой сессии меняется только в её strand,
+ * поэтому блокировку берут изнутри strand, но никогда не ждут strand под блокировкой.
+ */
 class Application : public std::enable_shared_from_this<Application> {
    public:
     using Sessions = std::vector<std::shared_ptr<GameSession>>;
-    using SessionIdHasher = util::TaggedHasher<GameSession::Id>;
-    using SessionIdToIndex = std::unordered_map<GameSession::Id, size_t, SessionIdHasher>;
     using MapIdHasher = util::TaggedHasher<model::Map::Id>;
-    using MapIdToSessionIdToIndex = std::unordered_map<model::Map::Id, SessionIdToIndex, MapIdHasher>;
+    using MapIdToSessions = std::unordered_map<model::Map::Id, Sessions, MapIdHasher>;
+
+    // Как часто (по игровому времени) малонаселённые сессии сливаются с соседними
+    static constexpr std::chrono::seconds CONSOLIDATION_PERIOD{30};
 
-    explicit Application(model::Game& game, bool randomize_spawn_points, net::io_context& ioc, std::optional<std::chrono::milliseconds> tick_period, std::optional<fs::path> state_file_path, std::optional<std::chrono::milliseconds> state_period, const DbConnectrioSettings& db_settings);
+    explicit Application(model::Game& game, bool randomize_spawn_points, net::io_context& ioc, std::optional<std::chrono::milliseconds> tick_period, size_t max_catch_up_ticks, std::optional<fs::path> state_file_path, std::optional<std::chrono::milliseconds> state_period, const DbConnectrioSettings& db_settings);
     const ListMapsUseCase::Maps& ListMaps() const noexcept;
     const std::shared_ptr<model::Map> FindMap(const std::string& id) const;
-    std::pair<std::string, std::string> JoinGame(const std::string& map_id, std::string name);
+    // Сессия карты, в которую войдёт новый игрок: наименее загруженная из тех, где есть место,
+    // или новая. nullptr, если карты нет
+    std::shared_ptr<GameSession> SelectSessionForJoin(const std::string& map_id);
+    // Вводит игрока в выбранную сессию. Вызывается в strand этой сессии.
+    // nullopt, если после выбора сессию успели закрыть: вход надо повторить с выбором новой
+    std::optional<std::pair<std::string, std::string>> JoinGame(const std::shared_ptr<GameSession>& session,
+                                                                 std::string name);
     std::vector<PlayerInfo> ListPlayers(const Token& token) const;
-    const GameState GetGameState(const Token& token) const;
-    void MovePlayer(const Token& token, MoveAction action);
+    GameState GetGameState(const Token& token) const;
+    MoveResult MovePlayer(const Token& token, std::optional<model::Direction> direction);
     void Tick(std::chrono::milliseconds delta);
+    // Запускает общий такт сессий
+    void Run();
     std::optional<RecordUseCase::Records> GetRecords(std::optional<size_t> offset, std::optional<size_t> limit);
-    std::optional<std::shared_ptr<GameSession>> GetSessionByToken(const Token& token);
-    std::optional<std::shared_ptr<GameSession>> FindSessionsByMapId(const model::Map::Id& session_map_id) const noexcept;
-    std::shared_ptr<GameSession> AddSession(const std::shared_ptr<model::Map> session_map);
-    void AddSession(std::shared_ptr<GameSession> session);
+    // nullopt, если токен неизвестен
+    std::optional<std::shared_ptr<GameSession>> GetSessionByToken(const Token& token) const;
     void SaveGame();
     void RestoreGame();
     std::optional<fs::path> GetStateFilePath();
     void CommitGameRecords(const std::vector<PlayerRecord>& player_records);
     void RemoveInactivePlayers(const GameSession::Id& session_id);
+    // Переводит игроков из сессий, заполненных не больше чем наполовину, в другие сессии
+    // той же карты и закрывает опустевшие. Токены игроков не меняются.
+    // Вызывается из обработчика партии: псы переходят в strand-ах сессий, а следующая
+    // партия ждёт, пока переход не завершится
+    void ConsolidateSessions();
 
    private:
+    using SessionIdHasher = util::TaggedHasher<GameSession::Id>;
+
+    // Игроки, которых слияние переводит из source
+    struct Transfer {
+        std::shared_ptr<GameSession> source;
+        std::vector<std::pair<std::shared_ptr<Player>, std::shared_ptr<GameSession>>> moves;
+    };
+    // Игроки и их псы, уже забранные из исходной сессии и идущие в target
+    struct Arrival {
+        std::shared_ptr<GameSession> target;
+        std::vector<std::shared_ptr<Player>> players;
+        std::vector<std::shared_ptr<model::Dog>> dogs;
+    };
+
+    // Выполняется в strand исходной сессии. hold держит следующую партию, пока переход не завершится
+    void ReleaseTransfer(const Transfer& transfer, std::shared_ptr<void> hold);
+    // Выполняется в strand принимающей сессии. remaining - сколько пачек из source ещё в пути
+    void AdoptArrival(const std::shared_ptr<GameSession>& source, const Arrival& arrival,
+                      std::shared_ptr<size_t> remaining);
+
+    // Методы ниже вызываются под mutex_
+    // Игроки сессии вместе с теми, кто переходит в неё при слиянии
+    size_t SessionLoad(const GameSession& session) const noexcept;
+    void FinishArrivals(const GameSession& session, size_t count);
+    // Наименее загруженная сессия карты, в которой ещё есть место
+    std::optional<std::shared_ptr<GameSession>> FindSessionForJoin(const model::Map::Id& session_map_id) const noexcept;
+    std::shared_ptr<GameSession> AddSession(const std::shared_ptr<model::Map> session_map);
+    void AddSession(std::shared_ptr<GameSession> session);
+    void OnTickBatch(std::chrono::milliseconds delta);
+    void RemoveSession(const std::shared_ptr<GameSession>& session);
+
     model::Game& game_;
+    mutable std::shared_mutex mutex_;
     Players players_;
     GameSession::Id session_id{0};
     Sessions sessions_;
@@ -45,15 +97,21 @@ class Application : public std::enable_shared_from_this<Application> {
     ListMapsUseCase list_maps_{game_.GetMaps()};
     GetMapUseCase map_finder_{game_};
     JoinGameUseCase joiner_;
-    ListPlayersUseCase list_players_{game_, player_tokens_, players_};
-    GameStateUseCase game_state_{game_, player_tokens_, players_};
+    ListPlayersUseCase list_players_{player_tokens_};
+    GameStateUseCase game_state_{player_tokens_};
     MovePlayerUseCase mover_{game_, player_tokens_};
-    TickUseCase ticker_{sessions_};
     RecordUseCase record_use_case;
     net::io_context& ioc_;
+    net::thread_pool gather_pool_{std::max(1u, std::thread::hardware_concurrency())};
     std::optional<std::chrono::milliseconds> tick_period_;
+    size_t max_catch_up_ticks_;
     std::optional<fs::path> state_file_path_;
     std::optional<std::chrono::milliseconds> state_period_;
-    std::shared_ptr<Ticker> save_game_ticker_;
-    MapIdToSessionIdToIndex map_id_to_sessions_id_to_index_;
+    std::shared_ptr<TickCoordinator> tick_coordinator_;
+    // Игровое время с последнего сохранения
+    std::chrono::milliseconds since_save_{0};
+    std::chrono::milliseconds since_consolidation_{0};
+    MapIdToSessions map_id_to_sessions_;
+    // Сколько игроков ещё в пути в каждую сессию
+    std::unordered_map<GameSession::Id, size_t, SessionIdHasher> arriving_;
 };
\ No newline at end of file
@@ -1,12 +1,84 @@
 #include "game_session.h"
 
+#include <algorithm>
 #include <cmath>
+#include <iterator>
+#include <limits>
 #include <ranges>
+#include <tuple>
 
 #include "item_dog_provider.h"
 
 using namespace model;
 
+namespace {
+
+bool SameDogState(const GameSession::Snapshot::DogState& lhs, const GameSession::Snapshot::DogState& rhs) {
+    return lhs.owner_id == rhs.owner_id && lhs.position == rhs.position && lhs.speed == rhs.speed &&
+           lhs.direction == rhs.direction && lhs.score == rhs.score && lhs.bag == rhs.bag;
+}
+
+// Записывает в change разницу двух отсортированных снимков тиков. Без предыдущего снимка
+// всё состояние новое. Переиспользуемое изменение сохраняет память своих списков
+void FillChange(const GameSession::Snapshot* previous, const GameSession::Snapshot& current,
+                GameSession::Snapshot::Change& change) {
+    change.changed_dogs.clear();
+    change.removed_owners.clear();
+    change.added_lost_objects.clear();
+    change.removed_lost_objects.clear();
+    // Псы обычно меняются каждый тик, запас под всех избавляет от роста списка
+    change.changed_dogs.reserve(current.dogs.size());
+    change.tick = current.tick;
+    change.previous_tick = previous ? previous->tick : 0;
+    change.previous.store(previous ? previous->change : nullptr, std::memory_order_relaxed);
+    static const std::vector<GameSession::Snapshot::DogState> no_dogs;
+    const auto& old_dogs = previous ? previous->dogs : no_dogs;
+    auto old_dog = old_dogs.begin();
+    for (const auto& dog : current.dogs) {
+        for (; old_dog != old_dogs.end() && old_dog->dog_id < dog.dog_id; ++old_dog) {
+            if (old_dog->owner_id) {
+                change.removed_owners.push_back(*old_dog->owner_id);
+            }
+        }
+        if (old_dog != old_dogs.end() && old_dog->dog_id == dog.dog_id) {
+            if (!SameDogState(*old_dog, dog)) {
+                change.changed_dogs.push_back(dog.dog_id);
+            }
+            ++old_dog;
+        } else {
+            change.changed_dogs.push_back(dog.dog_id);
+        }
+    }
+    for (; old_dog != old_dogs.end(); ++old_dog) {
+        if (old_dog->owner_id) {
+            change.removed_owners.push_back(*old_dog->owner_id);
+        }
+    }
+
+    // Предметы не меняются, только появляются и исчезают
+    if (previous && previous->lost_objects == current.lost_objects) {
+        return;
+    }
+    static const GameSession::Snapshot::LostObjectStates no_lost_objects;
+    const auto& old_objects = previous ? *previous->lost_objects : no_lost_objects;
+    auto old_object = old_objects.begin();
+    for (const auto& lost_object : *current.lost_objects) {
+        for (; old_object != old_objects.end() && old_object->id < lost_object.id; ++old_object) {
+            change.removed_lost_objects.push_back(old_object->id);
+        }
+        if (old_object != old_objects.end() && old_object->id == lost_object.id) {
+            ++old_object;
+        } else {
+            change.added_lost_objects.push_back(lost_object.id);
+        }
+    }
+    for (; old_object != old_objects.end(); ++old_object) {
+        change.removed_lost_objects.push_back(old_object->id);
+    }
+}
+
+}  // namespace
+
 geom::Vec2D DirectionToSpeed(Direction direction, double speed) noexcept {
     switch (direction) {
         case Direction::NORTH:
@@ -21,50 +93,174 @@ geom::Vec2D DirectionToSpeed(Direction direction, double speed) noexcept {
     return {};
 }
 
-GameSession::GameSession(Id id, std::shared_ptr<Map> map, LootGeneratorConfig loot_generator_config, net::io_context& ioc, std::optional<std::chrono::milliseconds> tick_period)
-    : id_(std::move(id)), map_{map}, dog_id{0}, lost_object_id{0}, road_index_{map->GetRoads()}, loot_generator_(loot_gen::LootGenerator::TimeInterval(static_cast<uint64_t>(loot_generator_config.period * 1000)), loot_generator_config.probability), gen(rd()), generator_type(0, map_->GetLootTypesSize() - 1), strand_(std::make_shared<SessionStrand>(net::make_strand(ioc)))
-    , tick_period_{tick_period} {
+GameSession::GameSession(Id id, std::shared_ptr<Map> map, LootGeneratorConfig loot_generator_config, net::io_context& ioc, std::optional<std::chrono::milliseconds> tick_period, net::thread_pool& gather_pool, size_t max_catch_up_ticks)
+    : id_(std::move(id)), map_{map}, road_index_{map->GetRoadIndex()}, loot_generator_(loot_gen::LootGenerator::TimeInterval(static_cast<uint64_t>(loot_generator_config.period * 1000)), loot_generator_config.probability), gen(rd()), generator_type(0, map_->GetLootTypesSize() - 1), strand_(std::make_shared<SessionStrand>(net::make_strand(ioc))), gather_pool_{gather_pool}
+    , tick_period_{tick_period}, max_catch_up_ticks_{max_catch_up_ticks} {
+    if (tick_period_) {
+        timestep_.emplace(tick_period_.value(), max_catch_up_ticks_);
+    }
+    tick_commands_.reserve(COMMAND_QUEUE_CAPACITY);
+    if (!road_index_) {
+        // Карта создана в обход Game::AddMap
+        road_index_ = std::make_shared<const model::RoadIndex>(map_->GetRoads());
+    }
+    PublishSnapshot();
 }
 
 std::shared_ptr<Dog> GameSession::AddDog(std::string name, geom::Point2D spawn) {
-    auto dog = std::make_shared<Dog>(dog_id, name, spawn, map_->GetBagCapacity());
-    dogs_.emplace(dog_id, dog);
-    *(dog_id) += 1;
+    if (clock_) {
+        Wake(clock_());
+    }
+    auto dog = std::make_shared<Dog>(dogs_.NextKey(), name, spawn, map_->GetBagCapacity());
+    dog_states_.Attach(*dog);
+    dogs_.Insert(dog);
+    roster_changed_ = true;
+    PublishSnapshot();
     return dog;
 }
 
 void GameSession::AddDog(std::shared_ptr<model::Dog> dog) {
-    dogs_.emplace(dog_id, dog);
-    *(dog_id) += 1;
-    net::dispatch(*strand_, [self = shared_from_this()]{
-        self->GenerateLoot(self->loot_generator_.GetPeriod());
-    });
+    if (clock_) {
+        Wake(clock_());
+    }
+    // Восстановленный пёс сохраняет свой идентификатор
+    dogs_.InsertAt(dog->GetId(), dog);
+    dog_states_.Attach(*dog);
+    roster_changed_ = true;
+    PublishSnapshot();
+    // Предметы для восстановленных псов генерируются один раз на всю пачку
+    if (!restored_loot_scheduled_.exchange(true)) {
+        net::dispatch(*strand_, [self = shared_from_this()]{
+            self->restored_loot_scheduled_ = false;
+            self->GenerateLoot(self->loot_generator_.GetPeriod());
+            self->PublishSnapshot();
+        });
+    }
+}
+
+std::shared_ptr<Dog> GameSession::ReleaseDog(const Dog::Id& id) {
+    if (!dogs_.Find(id)) {
+        throw std::out_of_range("Invalid dog id");
+    }
+    return ReleaseDogs({id}).front();
+}
+
+std::vector<std::shared_ptr<Dog>> GameSession::ReleaseDogs(const std::vector<Dog::Id>& ids) {
+    std::vector<std::shared_ptr<Dog>> released;
+    released.reserve(ids.size());
+    for (const auto& id : ids) {
+        auto* found = dogs_.Find(id);
+        if (!found) {
+            released.emplace_back();
+            continue;
+        }
+        auto dog = *found;
+        dog_states_.Detach(*dog);
+        dogs_.Erase(id);
+        released.push_back(std::move(dog));
+    }
+    roster_changed_ = true;
+    PublishSnapshot();
+    return released;
+}
+
+void GameSession::AdoptDog(std::shared_ptr<Dog> dog) {
+    AdoptDogs({std::move(dog)});
+}
+
+void GameSession::AdoptDogs(const std::vector<std::shared_ptr<Dog>>& dogs) {
+    if (clock_) {
+        Wake(clock_());
+    }
+    for (const auto& dog : dogs) {
+        dog->SetId(dogs_.NextKey());
+        dog_states_.Attach(*dog);
+        dogs_.Insert(dog);
+    }
+    roster_changed_ = true;
+    PublishSnapshot();
 }
 
-std::shared_ptr<LostObject> GameSession::AddLostObject(size_t type, geom::Point2D spawn, size_t value) {
-    auto lost_object = std::make_shared<LostObject>(lost_object_id, type, spawn, value);
-    lost_objects_.emplace(lost_object_id, lost_object);
-    *(lost_object_id) += 1;
-    return lost_object;
+LostObject::Id GameSession::AddLostObject(size_t type, geom::Point2D spawn, size_t value) {
+    recheck_idle_dogs_ = true;
+    lost_objects_changed_ = true;
+    return lost_objects_.Insert(LostObject{lost_objects_.NextKey(), type, spawn, value});
 }
 
-void GameSession::AddLostObject(std::shared_ptr<model::LostObject> lost_object){
-    lost_objects_.emplace(lost_object_id, std::move(lost_object));
-    *(lost_object_id) += 1;
+void GameSession::AddLostObject(model::LostObject lost_object){
+    const auto id = lost_object.GetId();
+    recheck_idle_dogs_ = true;
+    lost_objects_changed_ = true;
+    lost_objects_.InsertAt(id, std::move(lost_object));
+    PublishSnapshot();
 }
 
 void GameSession::SetDogDirection(const Dog::Id& id, std::optional<Direction> direction) {
-    if (auto it = dogs_.find(id); it != dogs_.end()) {
-        auto dog = it->second;
-        if (direction) {
-            dog->SetDirection(*direction);
-            dog->SetSpeed(DirectionToSpeed(*direction, map_->GetDogSpeed()));
-        } else {
-            dog->SetSpeed({});
-        }
+    if (clock_) {
+        Wake(clock_());
+    }
+    if (auto* found = dogs_.Find(id)) {
+        ApplyDirection(**found, direction);
     } else {
         throw std::out_of_range("Invalid dog id");
     }
+    PublishSnapshot();
+}
+
+void GameSession::SetDogOwner(const Dog::Id& id, uint32_t owner_id) {
+    auto* found = dogs_.Find(id);
+    if (!found) {
+        throw std::out_of_range("Invalid dog id");
+    }
+    (*found)->SetOwnerId(owner_id);
+    roster_changed_ = true;
+    PublishSnapshot();
+}
+
+bool GameSession::PushCommand(const Dog::Id& id, std::optional<Direction> direction) {
+    DogCommand command;
+    command.dog_id = id;
+    command.direction = direction;
+    return commands_.TryPush(command);
+}
+
+void GameSession::ApplyDirection(Dog& dog, std::optional<Direction> direction) {
+    if (direction) {
+        dog.SetDirection(*direction);
+        dog.SetSpeed(DirectionToSpeed(*direction, map_->GetDogSpeed()));
+    } else {
+        dog.SetSpeed({});
+    }
+}
+
+void GameSession::ApplyCommands() {
+    tick_commands_.clear();
+    DogCommand command;
+    while (tick_commands_.size() < COMMAND_QUEUE_CAPACITY && commands_.TryPop(command)) {
+        command.order = static_cast<uint32_t>(tick_commands_.size());
+        tick_commands_.push_back(command);
+    }
+    if (tick_commands_.empty()) {
+        return;
+    }
+    // Из команд одного пса действует только последняя
+    std::ranges::sort(tick_commands_, [](const DogCommand& lhs, const DogCommand& rhs) {
+        return std::tie(*lhs.dog_id, lhs.order) < std::tie(*rhs.dog_id, rhs.order);
+    });
+    for (size_t i = 0; i < tick_commands_.size(); ++i) {
+        const auto& last = tick_commands_[i];
+        if (i + 1 < tick_commands_.size() && tick_commands_[i + 1].dog_id == last.dog_id) {
+            continue;
+        }
+        // Пёс мог уйти из игры, пока команда ждала тика
+        if (auto* found = dogs_.Find(last.dog_id)) {
+            ApplyDirection(**found, last.direction);
+        }
+    }
+}
+
+std::shared_ptr<const GameSession::Snapshot> GameSession::GetSnapshot() const noexcept {
+    return snapshot_.load(std::memory_order_acquire);
 }
 
 const GameSession::Dogs& GameSession::GetDogs() const noexcept {
@@ -87,104 +283,75 @@ std::shared_ptr<GameSession::SessionStrand> GameSession::GetStrand() noexcept{
     return strand_;
 }
 
-void GameSession::MoveDog(Dog& dog, std::chrono::milliseconds time_delta) const {    
-    constexpr double HALF_ROAD_WIDTH = 0.8 / 2.0;
-    const auto pos = dog.GetPosition();
-    const auto speed = dog.GetSpeed();
-    const auto offset = speed * std::chrono::duration<double>(time_delta).count();
-
-    // Получаем информацию о дорогах, на которых находится пёс
-    auto roads = road_index_.GetRoadsAtPoint(
-        {static_cast<Coord>(std::round(pos.x)), static_cast<Coord>(std::round(pos.y))});
-
-    geom::Point2D min_coord{pos};
-    geom::Point2D max_coord{pos};
-
-    // Обновляет диапазон минимальных и максимальных координат,
-    // по которым может перемещаться пёс
-    auto update_range = [&min_coord, &max_coord](Point start, Point end) {
-        min_coord = {std::min(start.x - HALF_ROAD_WIDTH, min_coord.x),
-                     std::min(start.y - HALF_ROAD_WIDTH, min_coord.y)};
-        max_coord = {std::max(end.x + HALF_ROAD_WIDTH, max_coord.x),
-                     std::max(end.y + HALF_ROAD_WIDTH, max_coord.y)};
-    };
-
-    if (roads.horizontal) {
-        update_range(roads.horizontal->GetStart(), roads.horizontal->GetEnd());
-    }
-    if (roads.vertical) {
-        update_range(roads.vertical->GetStart(), roads.vertical->GetEnd());
-    }
-
-    auto new_pos = pos + offset;
-
-    auto new_speed = std::invoke([new_pos, speed = speed, min_coord, max_coord]() mutable {
-        if (!IsValueInRange(new_pos.x, min_coord.x, max_coord.x)) {
-            speed.x = 0;
-        }
-        if (!IsValueInRange(new_pos.y, min_coord.y, max_coord.y)) {
-            speed.y = 0;
-        }
-        return speed;
-    });
-    new_pos = {std::clamp(new_pos.x, min_coord.x, max_coord.x),
-               std::clamp(new_pos.y, min_coord.y, max_coord.y)};
-
-    dog.SetPosition(new_pos);
-    dog.SetSpeed(new_speed);
-    dog.SetGatherer();
-    dog.UpdatePlayTime(time_delta);
-    if(!dog.IsActive()) {
-        dog.UpdateInactiveTime(time_delta);
-    }
-}
-
 void GameSession::SetTickPeriod(const std::optional<std::chrono::milliseconds>& tick_period){
     tick_period_=tick_period;
+    if (tick_period_) {
+        timestep_.emplace(tick_period_.value(), max_catch_up_ticks_);
+    } else {
+        timestep_.reset();
+    }
 }
 
 void GameSession::Tick(std::chrono::milliseconds time_delta) {
-    for (auto& [id, dog] : dogs_) {
-        MoveDog(*dog, time_delta);
-        dog->GetPlayTime();
-    }
-
-    std::vector<std::shared_ptr<collision_detector::Item>> items;
-    std::vector<std::shared_ptr<model::Dog>> dogs;
-    for (auto [id, lost_obj] : lost_objects_) {
-        items.push_back(lost_obj);
-    }
-    for (auto office : map_->GetOffices()) {
-        items.push_back(std::make_shared<model::Office>(office));
-    }
-    for (auto [id, dog] : dogs_) {
-
-        dogs.push_back(dog);
-    }
-
-    model::ItemDogProvider provider(std::move(items), std::move(dogs));
-
-    auto collected_loot = collision_detector::FindGatherEvents(std::move(provider));
-
-    for (auto&& loot : collected_loot) {
-        auto item = provider.TryCastItemTo<LostObject>(loot.item_id);
-        auto gatherer = dogs_.find(provider.GetDogId(loot.gatherer_id))->second;
-        if (!gatherer.get()->isFullBag() && item != nullptr) {
-            FoundObject found_object{FoundObject::Id{*item->GetId()}, item->GetType(), item->GetValue()};
-            gatherer->AddItemToBag(found_object);
-            lost_objects_.erase(item->GetId());
-        }
-        auto office = provider.TryCastItemTo<Office>(loot.item_id);
-        if (!gatherer.get()->isEmptyBag() && office != nullptr) {
-            gatherer->ClearBag();
+    ApplyCommands();
+    dog_states_.MoveAll(time_delta, *road_index_);
+
+    tick_collected_.clear();
+    tick_collected_flags_.assign(lost_objects_.Size(), false);
+
+    // Неподвижный собиратель стоящего пса уже проверен со всеми старыми предметами
+    // и с тем же рюкзаком, поэтому повторная проверка ничего бы не изменила
+    const size_t gatherers = recheck_idle_dogs_ ? dog_states_.Size() : dog_states_.ChangedGatherersCount();
+    // Собиратели в слотах от moving_count - носы стоящих псов
+    const size_t moving_count = dog_states_.MovingCount();
+    recheck_idle_dogs_ = false;
+    model::ItemDogProvider provider(lost_objects_.Values(), map_->GetOfficeItems(), dog_states_, gatherers);
+
+    const auto& collected_loot = collision_detector::FindGatherEventsParallel(
+        provider,
+        [&pool = gather_pool_](std::function<void()> task) {
+            net::post(pool, std::move(task));
+        },
+        gather_workspace_);
+
+    for (const auto& loot : collected_loot) {
+        auto* gatherer = &provider.GetDog(loot.gatherer_id);
+        switch (provider.GetItemKind(loot.item_id)) {
+            case ItemDogProvider::ItemKind::LOST_OBJECT: {
+                // Предмет мог быть подобран другим псом раньше в этом же тике
+                if (gatherer->isFullBag() || tick_collected_flags_[loot.item_id]) {
+                    break;
+                }
+                const auto& item = provider.GetLostObject(loot.item_id);
+                FoundObject found_object{FoundObject::Id{*item.GetId()}, item.GetType(), item.GetValue()};
+                gatherer->AddItemToBag(found_object);
+                tick_collected_flags_[loot.item_id] = true;
+                tick_collected_.push_back(item.GetId());
+                // Со своим новым рюкзаком стоящий пёс может сдать предметы на следующем тике
+                recheck_idle_dogs_ = recheck_idle_dogs_ || loot.gatherer_id >= moving_count;
+                break;
+            }
+            case ItemDogProvider::ItemKind::OFFICE:
+                if (!gatherer->isEmptyBag()) {
+                    gatherer->ClearBag();
+                    // Освободившимся рюкзаком стоящий пёс может подобрать предметы на следующем тике
+                    recheck_idle_dogs_ = recheck_idle_dogs_ || loot.gatherer_id >= moving_count;
+                }
+                break;
         }
     }
+    // Удаляем подобранные предметы только после обработки всех событий,
+    // так как провайдер ссылается на них
+    for (const auto& id : tick_collected_) {
+        lost_objects_.Erase(id);
+    }
+    lost_objects_changed_ = lost_objects_changed_ || !tick_collected_.empty();
 
     RemoveInactiveDogs();
 }
 
 void GameSession::GenerateLoot(const std::chrono::milliseconds& delta_time) {
-    auto loot_size = loot_generator_.Generate(delta_time, lost_objects_.size(), dogs_.size());
+    auto loot_size = loot_generator_.Generate(delta_time, lost_objects_.Size(), dogs_.Size());
 
     for (int i = 0; i < loot_size; i++) {
         auto type = generator_type(gen);
@@ -200,25 +367,84 @@ void GameSession::GenerateLoot(const std::chrono::milliseconds& delta_time) {
     }
 };
 
-void GameSession::Run(){
-    if(tick_period_.has_value()){
-        update_game_state_ticker_ = std::make_shared<Ticker>(
-            strand_,
-            tick_period_.value(),
-            [self = shared_from_this()](const std::chrono::milliseconds& delta_time) {
-                self->Tick(self->tick_period_.value());
-            }
-        );
-        update_game_state_ticker_->Start();
-    }
-    generate_loot_ticker_ = std::make_shared<Ticker>(
-        strand_,
-        loot_generator_.GetPeriod(),
-        [self = shared_from_this()](const std::chrono::milliseconds& delta_time) {
-                self->GenerateLoot(delta_time);
+void GameSession::Advance(std::chrono::milliseconds delta) {
+    if (timestep_) {
+        // Симуляция идёт шагами длины tick_period_. Если такт пришёл с опозданием,
+        // выполняется несколько шагов подряд, чтобы время симуляции не отставало от реального
+        const size_t steps = timestep_->Advance(delta);
+        for (size_t step = 0; step < steps; ++step) {
+            Tick(timestep_->GetStep());
         }
-    );
-    generate_loot_ticker_->Start();
+    } else {
+        // Время задаёт клиент запросом tick
+        Tick(delta);
+    }
+    GenerateLoot(delta);
+}
+
+void GameSession::SetClock(Clock clock) {
+    clock_ = std::move(clock);
+    advanced_to_ = clock_();
+}
+
+void GameSession::AdvanceTo(std::chrono::milliseconds now) {
+    if (hibernating_) {
+        // Разбудили команда игрока или срок ухода пса. Догоняем время до последнего шага,
+        // а его выполняем обычным тиком: он применит команды и проверит уход псов
+        Wake(now - timestep_->GetStep());
+    }
+    if (now > advanced_to_) {
+        const auto delta = now - advanced_to_;
+        advanced_to_ = now;
+        Advance(delta);
+    }
+    PublishSnapshot(true);
+    TryHibernate();
+}
+
+bool GameSession::IsHibernating(std::chrono::milliseconds now) const noexcept {
+    return hibernating_.load(std::memory_order_acquire) && now.count() < wake_at_.load(std::memory_order_relaxed) &&
+           commands_.Empty();
+}
+
+void GameSession::TryHibernate() {
+    // Без таймера время задаёт клиент, и спать незачем
+    if (!clock_ || !timestep_ || dog_states_.MovingCount() != 0 || recheck_idle_dogs_ || !commands_.Empty()) {
+        return;
+    }
+    // Пока предметов меньше, чем псов, генератор может добавить предмет на любом шаге,
+    // и сон сдвинул бы его появление на момент пробуждения. Иначе за время сна генератор
+    // только копит время, как и при обычных тиках
+    if (lost_objects_.Size() < dogs_.Size()) {
+        return;
+    }
+    const auto next_retirement = dog_states_.NextRetirementIn();
+    wake_at_.store(next_retirement ? (advanced_to_ + *next_retirement).count()
+                                   : std::numeric_limits<std::chrono::milliseconds::rep>::max(),
+                   std::memory_order_relaxed);
+    hibernating_.store(true, std::memory_order_release);
+}
+
+void GameSession::Wake(std::chrono::milliseconds now) {
+    if (!hibernating_) {
+        return;
+    }
+    hibernating_.store(false, std::memory_order_release);
+    if (now <= advanced_to_) {
+        return;
+    }
+    const auto slept = now - advanced_to_;
+    advanced_to_ = now;
+    // Уход псов проверит следующий тик: действие игрока не должно удалять его пса
+    dog_states_.MoveAll(slept, *road_index_);
+    GenerateLoot(slept);
+}
+
+std::optional<FixedTimestep::Stats> GameSession::GetTimestepStats() const {
+    if (!timestep_) {
+        return std::nullopt;
+    }
+    return timestep_->GetStats();
 }
 
 void GameSession::AddRemoveInactivePlayersHandler(
@@ -232,33 +458,174 @@ void GameSession::AddHandlingFinishedPlayersEvent(
 };
 
 void GameSession::RemoveInactiveDogs() {
+    tick_retired_.clear();
+    dog_states_.TakeRetired(tick_retired_);
+    if (tick_retired_.empty()) {
+        return;
+    }
+
     std::vector<PlayerRecord> player_records;
+    player_records.reserve(tick_retired_.size());
+    for (Dog* dog : tick_retired_) {
+        player_records.push_back(PlayerRecord{dog->GetName(), dog->GetScore(), dog->GetPlayTime().value().count()});
+        const auto dog_id = dog->GetId();
+        // Пёс может пережить сессию в игроке, поэтому возвращаем ему состояние
+        dog_states_.Detach(*dog);
+        dogs_.Erase(dog_id);
+    }
+    roster_changed_ = true;
 
-    std::ranges::copy(
-        dogs_
-        | std::views::values
-        | std::views::filter(
-            [](auto dog) {
-                return static_cast<bool>(dog->GetPlayTime());
-            }
-        ) | std::views::transform(
-            [](auto dog)->PlayerRecord {
-                return PlayerRecord{dog->GetName(),
-                                        dog->GetScore(),
-                                        dog->GetPlayTime().value().count()};
-            }
-        ), std::back_inserter(player_records)
-    );
+    handle_finished_players_sig(std::move(player_records));
+    remove_inactive_players_sig(id_);
+};
+
+GameSession::DeferredPublish::DeferredPublish(GameSession& session)
+    : session_{session} {
+    ++session_.publish_deferrals_;
+}
 
-    if(player_records.empty()) {
+GameSession::DeferredPublish::~DeferredPublish() {
+    if (--session_.publish_deferrals_ == 0) {
+        session_.PublishSnapshot();
+    }
+}
+
+void GameSession::PublishSnapshot(bool new_tick) {
+    if (publish_deferrals_ > 0) {
         return;
     }
+    // Состав и предметы сортируются только при изменении, псы снимка идут в порядке состава
+    if (roster_changed_) {
+        roster_dogs_.clear();
+        roster_dogs_.reserve(dogs_.Size());
+        for (const auto& dog : dogs_) {
+            roster_dogs_.push_back(dog.get());
+        }
+        std::ranges::sort(roster_dogs_, {}, &Dog::GetId);
+        auto roster = std::make_shared<Snapshot::Roster>();
+        roster->reserve(roster_dogs_.size());
+        for (const auto* dog : roster_dogs_) {
+            roster->push_back({dog->GetId(), dog->GetOwnerId(), dog->GetName()});
+        }
+        roster_ = std::move(roster);
+        roster_changed_ = false;
+    }
+    if (lost_objects_changed_) {
+        auto lost_object_states = std::make_shared<Snapshot::LostObjectStates>();
+        lost_object_states->reserve(lost_objects_.Size());
+        for (const auto& lost_object : lost_objects_) {
+            lost_object_states->push_back({lost_object.GetId(), lost_object.GetType(), lost_object.GetPosition()});
+        }
+        std::ranges::sort(*lost_object_states, {}, &Snapshot::LostObjectState::id);
+        lost_object_states_ = std::move(lost_object_states);
+        lost_objects_changed_ = false;
+    }
+    auto snapshot = AcquireSnapshot();
+    snapshot->roster = roster_;
+    snapshot->dogs.clear();
+    snapshot->dogs.reserve(roster_dogs_.size());
+    for (const auto* dog : roster_dogs_) {
+        snapshot->dogs.push_back({dog->GetId(), dog->GetOwnerId(), dog->GetPosition(), dog->GetSpeed(),
+                                  dog->GetDirection(), dog->ShareBag(), dog->GetScore()});
+    }
+    snapshot->lost_objects = lost_object_states_;
+
+    if (new_tick || !tick_snapshot_) {
+        snapshot->tick = last_snapshot_tick_.fetch_add(1, std::memory_order_relaxed) + 1;
+        // Публикует снимки только strand сессии, так что снимок прошлого тика не поменяется
+        // Самое старое из остающихся изменений отпускает вытесняемое, и цепочка не растёт
+        if (const auto& oldest = history_[(history_count_ + 1) % Snapshot::HISTORY_SIZE]) {
+            oldest->previous.store(nullptr, std::memory_order_release);
+        }
+        auto& evicted = history_[history_count_ % Snapshot::HISTORY_SIZE];
+        std::shared_ptr<Snapshot::Change> change;
+        if (evicted && evicted.use_count() == 1) {
+            // До вытесняемого изменения больше не дойти по цепочке, и его никто не держит
+            std::atomic_thread_fence(std::memory_order_acquire);
+            change = std::move(evicted);
+        } else {
+            change = std::make_shared<Snapshot::Change>();
+        }
+        FillChange(tick_snapshot_.get(), *snapshot, *change);
+        evicted = change;
+        ++history_count_;
+        snapshot->change = std::move(change);
+        tick_snapshot_ = snapshot;
+    } else {
+        // Изменения вне тика войдут в изменение следующего тика
+        snapshot->tick = tick_snapshot_->tick;
+        snapshot->change = tick_snapshot_->change;
+    }
 
-    std::erase_if(dogs_, [](const auto& item) {
-        auto const& [dog_id, dog] = item;
-        return dog->GetPlayTime();
-    });
+    // Читатели держат свои копии указателя, старый снимок живёт, пока его кто-то читает
+    snapshot_.store(std::move(snapshot), std::memory_order_release);
+}
 
-    handle_finished_players_sig(std::move(player_records));
-    remove_inactive_players_sig(id_);
-};
\ No newline at end of file
+std::shared_ptr<GameSession::Snapshot> GameSession::AcquireSnapshot() {
+    // Читатели получают снимки только из snapshot_, поэтому снимок, который держит один пул,
+    // уже никто не читает и не начнёт читать
+    for (const auto& snapshot : snapshot_pool_) {
+        if (snapshot.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            snapshot->ResetSerialized();
+            return snapshot;
+        }
+    }
+    auto snapshot = std::make_shared<Snapshot>();
+    if (snapshot_pool_.size() < SNAPSHOT_POOL_SIZE) {
+        snapshot_pool_.push_back(snapshot);
+    }
+    return snapshot;
+}
+
+void GameSession::Snapshot::ResetSerialized() {
+    serialized_once_.emplace();
+    serialized_.clear();
+}
+
+std::optional<GameSession::Snapshot::Delta> GameSession::Snapshot::DeltaSince(uint64_t since) const {
+    if (since > tick) {
+        return std::nullopt;
+    }
+    Delta delta;
+    if (since == tick) {
+        return delta;
+    }
+    // Номера сессии идут с пропусками, поэтому since должен быть номером одного из её тиков,
+    // изменения после которого ещё в цепочке
+    std::vector<model::Dog::Id> changed_dogs;
+    std::vector<model::LostObject::Id> added_lost_objects;
+    for (auto node = change;; node = node->previous.load(std::memory_order_acquire)) {
+        if (!node || node->previous_tick < since) {
+            return std::nullopt;
+        }
+        changed_dogs.insert(changed_dogs.end(), node->changed_dogs.begin(), node->changed_dogs.end());
+        delta.removed_owners.insert(delta.removed_owners.end(), node->removed_owners.begin(), node->removed_owners.end());
+        added_lost_objects.insert(added_lost_objects.end(), node->added_lost_objects.begin(), node->added_lost_objects.end());
+        delta.removed_lost_objects.insert(delta.removed_lost_objects.end(), node->removed_lost_objects.begin(),
+                                          node->removed_lost_objects.end());
+        if (node->previous_tick == since) {
+            break;
+        }
+    }
+    std::ranges::sort(changed_dogs);
+    const auto [dogs_end, dogs_last] = std::ranges::unique(changed_dogs);
+    changed_dogs.erase(dogs_end, dogs_last);
+    for (const auto& id : changed_dogs) {
+        // Пёс, ушедший после изменения, попал в removed_owners
+        const auto it = std::ranges::lower_bound(dogs, id, {}, &DogState::dog_id);
+        if (it != dogs.end() && it->dog_id == id) {
+            delta.changed_dogs.push_back(&*it);
+        }
+    }
+    for (const auto& id : added_lost_objects) {
+        const auto it = std::ranges::lower_bound(*lost_objects, id, {}, &LostObjectState::id);
+        if (it != lost_objects->end() && it->id == id) {
+            delta.added_lost_objects.push_back(&*it);
+        }
+    }
+    std::ranges::sort(delta.removed_owners);
+    const auto [owners_end, owners_last] = std::ranges::unique(delta.removed_owners);
+    delta.removed_owners.erase(owners_end, owners_last);
+    return delta;
+}
@@ -1,11 +1,21 @@
 #pragma once
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/signals2/signal.hpp>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <random>
+#include <string>
 
 #include "model.h"
+#include "mpsc_queue.h"
 #include "player_record.h"
+#include "slot_map.h"
 #include "ticker.h"
 
 namespace net = boost::asio;
@@ -13,18 +23,152 @@ namespace net = boost::asio;
 class GameSession : public std::enable_shared_from_this<GameSession> {
    public:
     using Id = util::Tagged<uint32_t, GameSession>;
-    using DogIdHasher = util::TaggedHasher<model::Dog::Id>;
-    using LostObjectIdHasher = util::TaggedHasher<model::LostObject::Id>;
-    using Dogs = std::unordered_map<model::Dog::Id, std::shared_ptr<model::Dog>, DogIdHasher>;
-    using LostObjects = std::unordered_map<model::LostObject::Id, std::shared_ptr<model::LostObject>, LostObjectIdHasher>;
+    // Идентификаторы псов и предметов - ключи хранилищ с поколениями
+    using Dogs = util::SlotMap<model::Dog::Id, std::shared_ptr<model::Dog>>;
+    using LostObjects = util::SlotMap<model::LostObject::Id, model::LostObject>;
     using SessionStrand = net::strand<net::io_context::executor_type>;
+    // Часы общего такта: момент, до которого продвинуты сессии
+    using Clock = std::function<std::chrono::milliseconds()>;
 
-    explicit GameSession(Id id, std::shared_ptr<model::Map> map, model::LootGeneratorConfig loot_generator_config, net::io_context& ioc, std::optional<std::chrono::milliseconds> tick_period);
+    // Сколько шагов симуляции можно выполнить за одно срабатывание таймера, догоняя реальное время
+    static constexpr size_t DEFAULT_MAX_CATCH_UP_TICKS = 5;
+    // Сколько команд игроков может ждать начала тика
+    static constexpr size_t COMMAND_QUEUE_CAPACITY = 1024;
+    // Сколько снимков сессия держит для переиспользования
+    static constexpr size_t SNAPSHOT_POOL_SIZE = 4;
+
+    // Команда игрока псу. nullopt - остановиться
+    struct DogCommand {
+        model::Dog::Id dog_id;
+        std::optional<model::Direction> direction;
+        // Порядок поступления внутри тика
+        uint32_t order = 0;
+    };
+
+    // Неизменяемый снимок состояния сессии. Публикуется в strand сессии в конце тика и после
+    // изменений вне тика, читается из любого потока без блокировок.
+    // Номер снимка - номер тика, и каждый снимок помнит изменения нескольких предыдущих тиков,
+    // чтобы клиент мог получить только разницу с уже известным ему номером. Снимок, опубликованный
+    // вне тика, получает номер последнего тика, а его изменения попадают в изменение следующего.
+    // Номера сквозные для всех сессий: номер, полученный игроком до перевода в другую сессию,
+    // не совпадёт ни с одним из её снимков
+    struct Snapshot {
+        // Сколько последних изменений помнит сессия
+        static constexpr size_t HISTORY_SIZE = 64;
+
+        struct Member {
+            model::Dog::Id dog_id;
+            std::optional<uint32_t> owner_id;
+            std::string name;
+        };
+        struct DogState {
+            model::Dog::Id dog_id;
+            std::optional<uint32_t> owner_id;
+            geom::Point2D position;
+            geom::Vec2D speed;
+            model::Direction direction;
+            // Неизменившийся рюкзак снимки делят с псом и друг с другом
+            std::shared_ptr<const model::Dog::Bag> bag;
+            model::Score score;
+        };
+        struct LostObjectState {
+            model::LostObject::Id id;
+            size_t type;
+            geom::Point2D position;
+        };
+        using Roster = std::vector<Member>;
+        using LostObjectStates = std::vector<LostObjectState>;
+
+        // Чем снимок тика отличается от снимка предыдущего тика. Изменения связаны в цепочку
+        // от нового к старому, общую для всех снимков сессии
+        struct Change {
+            uint64_t tick = 0;
+            // Номер предыдущего тика сессии, 0 у первого
+            uint64_t previous_tick = 0;
+            // Новые и изменившиеся псы
+            std::vector<model::Dog::Id> changed_dogs;
+            std::vector<uint32_t> removed_owners;
+            std::vector<model::LostObject::Id> added_lost_objects;
+            std::vector<model::LostObject::Id> removed_lost_objects;
+            // Сессия обрывает цепочку после HISTORY_SIZE изменений, поэтому ссылка атомарная
+            std::atomic<std::shared_ptr<const Change>> previous;
+        };
+
+        // Разница с состоянием на момент снимка since. Указатели ведут в этот снимок
+        struct Delta {
+            std::vector<const DogState*> changed_dogs;
+            std::vector<uint32_t> removed_owners;
+            std::vector<const LostObjectState*> added_lost_objects;
+            std::vector<model::LostObject::Id> removed_lost_objects;
+        };
+
+        // nullopt - since не из истории этой сессии: устарел, из будущего или выдан другой сессией.
+        // Тогда нужно полное состояние
+        std::optional<Delta> DeltaSince(uint64_t since) const;
+
+        uint64_t tick = 0;
+        // Состав сессии и предметы меняются редко, поэтому снимки между изменениями делят один список
+        std::shared_ptr<const Roster> roster;
+        // Отсортированы по идентификаторам
+        std::vector<DogState> dogs;
+        std::shared_ptr<const LostObjectStates> lost_objects;
+        // Изменение тика tick, начало цепочки
+        std::shared_ptr<const Change> change;
+
+        // Снимок в виде ответа клиенту. Сериализуется один раз при первом запросе,
+        // остальные запросы того же тика получают готовую строку
+        template <typename Serializer>
+        const std::string& GetSerialized(Serializer&& serializer) const {
+            std::call_once(*serialized_once_, [this, &serializer] {
+                serialized_ = serializer(*this);
+            });
+            return serialized_;
+        }
+
+       private:
+        friend class GameSession;
+
+        // Сессия переиспользует снимки, которые уже никто не читает
+        void ResetSerialized();
+
+        mutable std::optional<std::once_flag> serialized_once_{std::in_place};
+        mutable std::string serialized_;
+    };
+
+    // Пока жив, изменения сессии не публикуются, а при уничтожении публикуется один снимок.
+    // Так восстановление сессии не копирует её состояние после каждого пса и предмета
+    class DeferredPublish {
+       public:
+        explicit DeferredPublish(GameSession& session);
+        DeferredPublish(const DeferredPublish&) = delete;
+        DeferredPublish& operator=(const DeferredPublish&) = delete;
+        ~DeferredPublish();
+
+       private:
+        GameSession& session_;
+    };
+
+    explicit GameSession(Id id, std::shared_ptr<model::Map> map, model::LootGeneratorConfig loot_generator_config, net::io_context& ioc, std::optional<std::chrono::milliseconds> tick_period, net::thread_pool& gather_pool, size_t max_catch_up_ticks = DEFAULT_MAX_CATCH_UP_TICKS);
     std::shared_ptr<model::Dog> AddDog(std::string name, geom::Point2D spawn);
     void AddDog(std::shared_ptr<model::Dog> dog);
-    std::shared_ptr<model::LostObject> AddLostObject(size_t type, geom::Point2D spawn, size_t value);
-    void AddLostObject(std::shared_ptr<model::LostObject> lost_object);
+    // Забирает пса из сессии вместе с рюкзаком, счётом и временем игры
+    std::shared_ptr<model::Dog> ReleaseDog(const model::Dog::Id& id);
+    // Забирает псов пачкой и публикует один снимок. На месте пса, которого уже нет, - nullptr
+    std::vector<std::shared_ptr<model::Dog>> ReleaseDogs(const std::vector<model::Dog::Id>& ids);
+    // Принимает пса из другой сессии на той же карте и выдаёт ему новый идентификатор
+    void AdoptDog(std::shared_ptr<model::Dog> dog);
+    // Принимает псов пачкой и публикует один снимок
+    void AdoptDogs(const std::vector<std::shared_ptr<model::Dog>>& dogs);
+    model::LostObject::Id AddLostObject(size_t type, geom::Point2D spawn, size_t value);
+    void AddLostObject(model::LostObject lost_object);
     void SetDogDirection(const model::Dog::Id& id, std::optional<model::Direction> direction);
+    // Назначает псу игрока, под чьим идентификатором он попадает в снимки
+    void SetDogOwner(const model::Dog::Id& id, uint32_t owner_id);
+    // Ставит команду в очередь, не заходя в strand. Тик применяет последнюю команду каждого пса.
+    // Можно вызывать из любого потока. Возвращает false, если очередь переполнена
+    bool PushCommand(const model::Dog::Id& id, std::optional<model::Direction> direction);
+    // Последний опубликованный снимок. Можно вызывать из любого потока
+    std::shared_ptr<const Snapshot> GetSnapshot() const noexcept;
     const Dogs& GetDogs() const noexcept;
     const LostObjects& GetLostObjects() const noexcept;
     const std::shared_ptr<model::Map> GetMap() const noexcept;
@@ -32,31 +176,88 @@ class GameSession : public std::enable_shared_from_this<GameSession> {
     std::shared_ptr<SessionStrand> GetStrand() noexcept;
     void SetTickPeriod(const std::optional<std::chrono::milliseconds>& tick_period);
     void Tick(std::chrono::milliseconds time_delta);
-    void MoveDog(model::Dog& dog, std::chrono::milliseconds time_delta) const;
     void GenerateLoot(const std::chrono::milliseconds& delta_time);
-    void Run();
+    // Подключает сессию к общему такту, начиная с текущего момента часов
+    void SetClock(Clock clock);
+    // Продвигает сессию до момента now общего такта: тики и генерация предметов.
+    // Вызывается в strand сессии
+    void AdvanceTo(std::chrono::milliseconds now);
+    // Сессия спит: пока ни один пёс не движется, тики ничего не меняют. Её будят команда
+    // игрока, вход нового игрока или наступление момента, когда пора проверить уход псов
+    bool IsHibernating(std::chrono::milliseconds now) const noexcept;
+    // Счётчики шагов симуляции, если задан tick_period
+    std::optional<FixedTimestep::Stats> GetTimestepStats() const;
     void AddRemoveInactivePlayersHandler(std::function<void(const GameSession::Id&)> handler);
     void AddHandlingFinishedPlayersEvent(std::function<void(const std::vector<PlayerRecord>&)> handler);
 
    private:
     Id id_;
+    // Состояние псов для тика. Объявлено раньше dogs_, чтобы пережить их
+    model::DogStates dog_states_;
     Dogs dogs_;
     LostObjects lost_objects_;
     const std::shared_ptr<model::Map> map_;
-    model::Dog::Id dog_id{0};
-    model::LostObject::Id lost_object_id;
-    model::RoadIndex road_index_;
+    // Общий индекс дорог карты
+    std::shared_ptr<const model::RoadIndex> road_index_;
     loot_gen::LootGenerator loot_generator_;
     std::random_device rd;
     std::default_random_engine gen;
     std::uniform_int_distribution<size_t> generator_type;
     std::shared_ptr<SessionStrand> strand_;
+    // Пул для параллельного поиска событий сбора в больших сессиях
+    net::thread_pool& gather_pool_;
     std::optional<std::chrono::milliseconds> tick_period_;
-    std::shared_ptr<Ticker> update_game_state_ticker_;
-    std::shared_ptr<Ticker> generate_loot_ticker_;
+    size_t max_catch_up_ticks_;
+    std::optional<FixedTimestep> timestep_;
+    // Буферы Tick, переиспользуемые между тиками. В установившемся режиме тик не выделяет память
+    collision_detector::GatherWorkspace gather_workspace_;
+    std::vector<model::LostObject::Id> tick_collected_;
+    // Подобран ли в этом тике предмет с данным индексом в lost_objects_
+    std::vector<bool> tick_collected_flags_;
+    std::vector<model::Dog*> tick_retired_;
+    util::BoundedMpscQueue<DogCommand> commands_{COMMAND_QUEUE_CAPACITY};
+    std::vector<DogCommand> tick_commands_;
+    // Появились новые предметы или у стоящего пса изменился рюкзак: стоящих псов надо проверить заново
+    bool recheck_idle_dogs_ = false;
+    Clock clock_;
+    std::chrono::milliseconds advanced_to_{0};
+    std::atomic<bool> hibernating_{false};
+    std::atomic<std::chrono::milliseconds::rep> wake_at_{0};
+    std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+    std::shared_ptr<const Snapshot::Roster> roster_;
+    // Псы в порядке roster_, то есть по возрастанию идентификаторов
+    std::vector<const model::Dog*> roster_dogs_;
+    bool roster_changed_ = true;
+    std::shared_ptr<const Snapshot::LostObjectStates> lost_object_states_;
+    bool lost_objects_changed_ = true;
+    // Сколько DeferredPublish сейчас откладывают публикацию
+    size_t publish_deferrals_ = 0;
+    // Генерация предметов для восстановленных псов уже ждёт strand
+    std::atomic<bool> restored_loot_scheduled_{false};
+    // Последний снимок тика: от него считается изменение следующего тика
+    std::shared_ptr<const Snapshot> tick_snapshot_;
+    // Снимки, которые сессия заполняет заново, когда их перестают читать. Вместе с изменениями,
+    // вытесненными из history_, они избавляют публикацию снимка от выделений памяти
+    std::vector<std::shared_ptr<Snapshot>> snapshot_pool_;
+    // Последние изменения по кругу, чтобы обрывать цепочку, не обходя её
+    std::array<std::shared_ptr<Snapshot::Change>, Snapshot::HISTORY_SIZE> history_;
+    // Сколько изменений создано за всё время
+    size_t history_count_ = 0;
+    // Номер последнего опубликованного снимка среди всех сессий
+    inline static std::atomic<uint64_t> last_snapshot_tick_{0};
 
     boost::signals2::signal<void(const GameSession::Id&)> remove_inactive_players_sig;
     boost::signals2::signal<void(const std::vector<PlayerRecord>&)> handle_finished_players_sig;
 
+    void Advance(std::chrono::milliseconds delta);
+    void ApplyCommands();
+    void ApplyDirection(model::Dog& dog, std::optional<model::Direction> direction);
+    void TryHibernate();
+    // Догоняет время сна. Псы всё это время стояли, поэтому хватает одного сдвига часов
+    void Wake(std::chrono::milliseconds now);
     void RemoveInactiveDogs();
+    // new_tick - снимок конца тика, он получает новый номер и изменение в цепочке
+    void PublishSnapshot(bool new_tick = false);
+    // Свободный снимок из пула или новый
+    std::shared_ptr<Snapshot> AcquireSnapshot();
 };
\ No newline at end of file
@@ -41,8 +41,8 @@ void Player::SetSession(std::shared_ptr<GameSession> session){
 }
 
 
-void Player::Move(MoveAction action) {
-    session_->SetDogDirection(dog_->GetId(), MoveActionToDirection(action));
+bool Player::Move(std::optional<model::Direction> direction) {
+    return session_->PushCommand(dog_->GetId(), direction);
 }
 
 Token PlayersToken::Generate() {
@@ -129,6 +129,11 @@ const std::optional<Players::PlayerIdToPlayer> Players::FindPlayersBySessionId(c
     return std::nullopt;
 }
 
+size_t Players::CountPlayersInSession(const GameSession::Id& session_id) const noexcept {
+    auto it_player_id_to_player = session_id_to_player_id_to_player_.find(session_id);
+    return it_player_id_to_player != session_id_to_player_id_to_player_.end() ? it_player_id_to_player->second.size() : 0;
+}
+
 void Players::ErasePlayerFromSession(const GameSession::Id& session_id, const Player::Id& player_id){
     session_id_to_player_id_to_player_.find(session_id)->second.erase(session_id_to_player_id_to_player_.find(session_id)->second.find(player_id));
 }
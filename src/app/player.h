@@ -27,7 +27,8 @@ class Player {
     std::shared_ptr<model::Dog> GetDog() const noexcept;
     const std::shared_ptr<GameSession> GetSession() const noexcept;
     void SetSession(std::shared_ptr<GameSession> session);
-    void Move(MoveAction action);
+    // Ставит команду в очередь сессии. false, если очередь переполнена
+    [[nodiscard]] bool Move(std::optional<model::Direction> direction);
 
    private:
     std::shared_ptr<GameSession> session_;
@@ -43,6 +44,7 @@ class Players {
     std::shared_ptr<Player> Add(std::shared_ptr<model::Dog> dog, std::shared_ptr<GameSession> session);
     void Add(std::shared_ptr<Player> player);
     const std::optional<PlayerIdToPlayer> FindPlayersBySessionId(const GameSession::Id& session_id) const;
+    size_t CountPlayersInSession(const GameSession::Id& session_id) const noexcept;
     void ErasePlayerFromSession(const GameSession::Id& session_id, const Player::Id& player_id);
     void EraseSession(const GameSession::Id& session_id);
 
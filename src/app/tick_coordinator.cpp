@@ -0,0 +1,126 @@
+#include "tick_coordinator.h"
+
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <cassert>
+#include <iterator>
+
+TickCoordinator::TickCoordinator(net::io_context& ioc, std::optional<std::chrono::milliseconds> period)
+    : strand_{std::make_shared<Strand>(net::make_strand(ioc))}, period_{period} {
+}
+
+void TickCoordinator::SetBatchHandler(BatchHandler handler) {
+    batch_handler_ = std::move(handler);
+}
+
+void TickCoordinator::AddSession(std::shared_ptr<GameSession> session) {
+    std::lock_guard lock{sessions_mutex_};
+    session->SetClock([clock = clock_] {
+        return std::chrono::milliseconds{clock->load(std::memory_order_acquire)};
+    });
+    sessions_.push_back(std::move(session));
+}
+
+void TickCoordinator::RemoveSession(const GameSession::Id& id) {
+    std::lock_guard lock{sessions_mutex_};
+    std::erase_if(sessions_, [&id](const auto& session) {
+        return session->GetId() == id;
+    });
+}
+
+void TickCoordinator::Start() {
+    if (!period_) {
+        return;
+    }
+    ticker_ = std::make_shared<Ticker>(
+        strand_,
+        period_.value(),
+        [self = shared_from_this()](const std::chrono::milliseconds& delta_time) {
+            self->Enqueue(delta_time);
+        });
+    ticker_->Start();
+}
+
+void TickCoordinator::Tick(std::chrono::milliseconds delta) {
+    net::post(*strand_, [self = shared_from_this(), delta] {
+        self->Enqueue(delta);
+    });
+}
+
+std::function<void()> TickCoordinator::HoldNextBatch() {
+    assert(strand_->running_in_this_thread());
+    ++holds_;
+    return [self = shared_from_this()] {
+        net::post(*self->strand_, [self] {
+            if (--self->holds_ == 0) {
+                self->ContinueBatches();
+            }
+        });
+    };
+}
+
+void TickCoordinator::Enqueue(std::chrono::milliseconds delta) {
+    pending_ += delta;
+    if (!batch_running_) {
+        RunBatch();
+    }
+}
+
+void TickCoordinator::RunBatch() {
+    batch_running_ = true;
+    batch_delta_ = std::exchange(pending_, std::chrono::milliseconds{0});
+    {
+        std::lock_guard lock{sessions_mutex_};
+        batch_clock_ = std::chrono::milliseconds{clock_->load(std::memory_order_relaxed)} + batch_delta_;
+        clock_->store(batch_clock_.count(), std::memory_order_release);
+        batch_.clear();
+        std::ranges::copy_if(sessions_, std::back_inserter(batch_), [now = batch_clock_](const auto& session) {
+            return !session->IsHibernating(now);
+        });
+    }
+    if (batch_.empty()) {
+        FinishBatch();
+        return;
+    }
+    unfinished_.store(batch_.size(), std::memory_order_relaxed);
+    for (const auto& session : batch_) {
+        net::post(*session->GetStrand(), [self = shared_from_this(), session, now = batch_clock_] {
+            try {
+                session->AdvanceTo(now);
+            } catch (...) {
+                // Партия должна завершиться, даже если сессия упала
+                self->OnSessionDone();
+                throw;
+            }
+            self->OnSessionDone();
+        });
+    }
+}
+
+void TickCoordinator::OnSessionDone() {
+    if (unfinished_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        net::post(*strand_, [self = shared_from_this()] {
+            self->FinishBatch();
+        });
+    }
+}
+
+void TickCoordinator::FinishBatch() {
+    batch_.clear();
+    if (batch_handler_) {
+        batch_handler_(batch_delta_);
+    }
+    if (holds_ > 0) {
+        // Партия считается незавершённой, и время копится до снятия отсрочки
+        return;
+    }
+    ContinueBatches();
+}
+
+void TickCoordinator::ContinueBatches() {
+    batch_running_ = false;
+    // Время, накопившееся за партию, отрабатываем сразу
+    if (pending_ > std::chrono::milliseconds::zero()) {
+        RunBatch();
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "game_session.h"
+#include "ticker.h"
+
+namespace net = boost::asio;
+
+/*
+ * Общий такт всех игровых сессий. Вместо пары таймеров в каждой сессии на сервер
+ * заводится один таймер: по его срабатыванию все сессии получают прошедшее время
+ * одной партией. Шаг сессии выполняется в её strand, а strand-ы разбирают потоки
+ * io_context: освободившийся поток берёт следующую сессию, пока другие заняты.
+ * Новая партия не начинается, пока не завершилась предыдущая - прошедшее время
+ * копится и уходит в следующую. После каждой партии вызывается обработчик партии,
+ * в нём сессии уже не тикают (например, там сохраняется состояние игры). Обработчик может
+ * отложить следующую партию, пока в strand-ах сессий не завершится начатая им работа.
+ * Спящие сессии в партию не попадают, а проснувшись, сами догоняют часы такта.
+ */
+class TickCoordinator : public std::enable_shared_from_this<TickCoordinator> {
+   public:
+    using Strand = net::strand<net::io_context::executor_type>;
+    using BatchHandler = std::function<void(std::chrono::milliseconds delta)>;
+
+    // Без period партии запускаются только вызовом Tick
+    TickCoordinator(net::io_context& ioc, std::optional<std::chrono::milliseconds> period);
+
+    void SetBatchHandler(BatchHandler handler);
+    void AddSession(std::shared_ptr<GameSession> session);
+    void RemoveSession(const GameSession::Id& id);
+    // Запускает таймер, если задан период
+    void Start();
+    // Продвигает все сессии на delta. Выполняется асинхронно
+    void Tick(std::chrono::milliseconds delta);
+    // Вызывается из обработчика партии. Следующая партия не начнётся, пока не будет
+    // вызвана возвращённая функция (из любого потока, ровно один раз)
+    std::function<void()> HoldNextBatch();
+
+   private:
+    void Enqueue(std::chrono::milliseconds delta);
+    void RunBatch();
+    void OnSessionDone();
+    void FinishBatch();
+    void ContinueBatches();
+
+    std::shared_ptr<Strand> strand_;
+    std::optional<std::chrono::milliseconds> period_;
+    std::shared_ptr<Ticker> ticker_;
+    BatchHandler batch_handler_;
+
+    std::mutex sessions_mutex_;
+    std::vector<std::shared_ptr<GameSession>> sessions_;
+    // Часы такта - сумма delta всех запущенных партий. Меняются под sessions_mutex_
+    std::shared_ptr<std::atomic<std::chrono::milliseconds::rep>> clock_ =
+        std::make_shared<std::atomic<std::chrono::milliseconds::rep>>(0);
+
+    // Состояние партии, доступно только из strand_ (кроме счётчика)
+    std::vector<std::shared_ptr<GameSession>> batch_;
+    std::chrono::milliseconds batch_delta_{0};
+    std::chrono::milliseconds batch_clock_{0};
+    std::chrono::milliseconds pending_{0};
+    bool batch_running_ = false;
+    // Сколько отсрочек следующей партии ещё не снято
+    size_t holds_ = 0;
+    std::atomic<size_t> unfinished_{0};
+};
@@ -1,39 +1,15 @@
 #include "use_cases.h"
 
-GameStateUseCase::GameStateUseCase(std::reference_wrapper<const model::Game> game,
-                                   std::reference_wrapper<const PlayersToken> player_tokens,
-                                   std::reference_wrapper<const Players> players)
-    : game_{game.get()}, players_{players.get()}, player_tokens_{player_tokens.get()} {
+GameStateUseCase::GameStateUseCase(std::reference_wrapper<const PlayersToken> player_tokens)
+    : player_tokens_{player_tokens.get()} {
 }
 
 GameState GameStateUseCase::GetGameState(const Token& token) const {
     auto player = player_tokens_.FindPlayerByToken(token);
     if (player == nullptr)
-        return {};
-
-    auto players = players_.FindPlayersBySessionId(player->GetSession()->GetId());
-
-    const auto lost_objects = player->GetSession()->GetLostObjects();
-    GameState result;
-    result.players.reserve(players->size());
-    result.lost_objects.reserve(lost_objects.size());
-
-    for (const auto& [player_id, player] : players.value()) {
-        auto dog = player->GetDog();
-        PlayerState::Bag bag;
-        for (const auto& item : dog->GetBag()) {
-            bag.emplace_back(item.id, item.type);
-        }
-        result.players.emplace_back(player->GetId(), (*dog).GetPosition(), (*dog).GetSpeed(), (*dog).GetDirection(), std::move(bag), (*dog).GetScore());
-    }
-
-    for (const auto& [lost_object_id, lost_object] : lost_objects) {
-        result.lost_objects.emplace_back(lost_object_id, (*lost_object).GetType(), (*lost_object).GetPosition());
-    }
-
-    result.players = {result.players.rbegin(), result.players.rend()};
-    result.lost_objects = {result.lost_objects.rbegin(), result.lost_objects.rend()};
-    return result;
+        return nullptr;
+    // Живое состояние сессии меняется в её strand, читаем только снимок
+    return player->GetSession()->GetSnapshot();
 }
 
 JoinGameUseCase::JoinGameUseCase(PlayersToken& players_tokens, Players& players, bool randomize_spawn_points) : player_tokens_{&players_tokens}, players_{&players}, randomize_spawn_points_{randomize_spawn_points} {
@@ -60,6 +36,7 @@ std::pair<std::string, std::string> JoinGameUseCase::Join(std::shared_ptr<GameSe
     }
     auto spawn_point = GenerateSpawnPoint(session->GetMap()->GetRoads(), randomize_spawn_points_);
     auto player = players_->Add(session->AddDog(std::move(name), spawn_point), session);
+    session->SetDogOwner(player->GetDog()->GetId(), *player->GetId());
     auto token = player_tokens_->AddPlayer(player);
     return std::make_pair(*token, std::to_string(*(player->GetId())));
 }
@@ -83,10 +60,8 @@ const std::shared_ptr<model::Map> GetMapUseCase::FindMap(const std::string& id)
     return game_.FindMap(model::Map::Id{id});
 }
 
-ListPlayersUseCase::ListPlayersUseCase(std::reference_wrapper<const model::Game> game,
-                                       std::reference_wrapper<const PlayersToken> player_tokens,
-                                       std::reference_wrapper<const Players> players)
-    : game_{game.get()}, player_tokens_{player_tokens.get()}, players_{players.get()} {
+ListPlayersUseCase::ListPlayersUseCase(std::reference_wrapper<const PlayersToken> player_tokens)
+    : player_tokens_{player_tokens.get()} {
 }
 
 std::vector<PlayerInfo> ListPlayersUseCase::ListPlayers(const Token& token) const {
@@ -94,40 +69,28 @@ std::vector<PlayerInfo> ListPlayersUseCase::ListPlayers(const Token& token) cons
     if (player == nullptr)
         return {};
 
-    auto players = players_.FindPlayersBySessionId(player->GetSession()->GetId());
-
+    const auto roster = player->GetSession()->GetSnapshot()->roster;
     std::vector<PlayerInfo> result;
-    result.reserve(players->size());
-
-    for (const auto [player_id, player] : players.value()) {
-        result.emplace_back(PlayerInfo{std::to_string(*player->GetId()), player->GetDog()->GetName()});
+    result.reserve(roster->size());
+    for (const auto& member : *roster) {
+        if (member.owner_id) {
+            result.emplace_back(PlayerInfo{std::to_string(*member.owner_id), member.name});
+        }
     }
-
-    return {result.rbegin(), result.rend()};
+    return result;
 }
 
 MovePlayerUseCase::MovePlayerUseCase(model::Game& game, std::reference_wrapper<const PlayersToken> player_tokens)
     : game_{game}, player_tokens_{player_tokens.get()} {
 }
 
-void MovePlayerUseCase::Move(const Token& token, MoveAction action) {
+MoveResult MovePlayerUseCase::Move(const Token& token, std::optional<model::Direction> direction) {
     auto player = player_tokens_.FindPlayerByToken(token);
-    if (player)
-        net::dispatch(*(player->GetSession()->GetStrand()), [player, &action] {
-            player->Move(action);
-        });
-}
-
-TickUseCase::TickUseCase(TickUseCase::Sessions& sessions)
-    : sessions_{sessions} {
-}
-
-void TickUseCase::Tick(std::chrono::milliseconds delta) {
-    for (auto& session : sessions_) {
-        net::dispatch(*(session->GetStrand()), [session, &delta] {
-            session->Tick(delta);
-        });
+    if (!player) {
+        return MoveResult::UNKNOWN_PLAYER;
     }
+    // Команда ждёт в очереди сессии начала тика, strand сессии не нужен
+    return player->Move(direction) ? MoveResult::OK : MoveResult::QUEUE_FULL;
 }
 
 RecordUseCase::RecordUseCase(PlayerRecordRepository& player_record_repository) : player_record_repository_(player_record_repository) {
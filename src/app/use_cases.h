@@ -12,45 +12,16 @@ struct Record {
     int64_t playTime;
 };
 
-struct LostObject {
-    model::LostObject::Id id;
-    size_t type;
-    geom::Point2D position;
-};
-
-struct BagItem {
-    model::FoundObject::Id id;
-    size_t type;
-};
-
-struct PlayerState {
-    using Bag = std::vector<BagItem>;
-    Player::Id id;
-    geom::Point2D position;
-    geom::Vec2D speed;
-    model::Direction direction;
-    Bag bag;
-    size_t score;
-};
-
-struct GameState {
-    using PlayersStates = std::vector<PlayerState>;
-    using LostObjectsStates = std::vector<LostObject>;
-
-    PlayersStates players;
-    LostObjectsStates lost_objects;
-};
+// Состояние сессии игрока - опубликованный сессией снимок, его не копируют
+using GameState = std::shared_ptr<const GameSession::Snapshot>;
 
 class GameStateUseCase {
    public:
-    GameStateUseCase(std::reference_wrapper<const model::Game> game,
-                     std::reference_wrapper<const PlayersToken> player_tokens,
-                     std::reference_wrapper<const Players> players);
+    explicit GameStateUseCase(std::reference_wrapper<const PlayersToken> player_tokens);
+    // nullptr, если токен неизвестен
     GameState GetGameState(const Token& token) const;
 
    private:
-    const model::Game& game_;
-    const Players& players_;
     const PlayersToken& player_tokens_;
 };
 
@@ -99,39 +70,31 @@ struct PlayerInfo {
 
 class ListPlayersUseCase {
    public:
-    ListPlayersUseCase(std::reference_wrapper<const model::Game> game,
-                       std::reference_wrapper<const PlayersToken> player_tokens,
-                       std::reference_wrapper<const Players> players);
+    explicit ListPlayersUseCase(std::reference_wrapper<const PlayersToken> player_tokens);
     std::vector<PlayerInfo> ListPlayers(const Token& token) const;
 
    private:
-    const model::Game& game_;
     const PlayersToken& player_tokens_;
-    const Players& players_;
+};
+
+enum class MoveResult {
+    OK,
+    // Игрока с таким токеном уже нет
+    UNKNOWN_PLAYER,
+    // Сессия не успевает разбирать команды
+    QUEUE_FULL
 };
 
 class MovePlayerUseCase {
    public:
     MovePlayerUseCase(model::Game& game, std::reference_wrapper<const PlayersToken> player_tokens);
-    void Move(const Token& token, MoveAction action);
+    MoveResult Move(const Token& token, std::optional<model::Direction> direction);
 
    private:
     model::Game& game_;
     const PlayersToken& player_tokens_;
 };
 
-class GameSession;
-
-class TickUseCase {
-   public:
-    using Sessions = std::vector<std::shared_ptr<GameSession>>;
-    explicit TickUseCase(Sessions& sessions);
-    void Tick(std::chrono::milliseconds delta);
-
-   private:
-    Sessions& sessions_;
-};
-
 #include "database.h"
 
 class RecordUseCase {
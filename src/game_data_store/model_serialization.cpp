@@ -19,11 +19,11 @@ DogRepr::DogRepr(const std::shared_ptr<const model::Dog> dog)
     return dog;
 }
 
-LostObjectRepr::LostObjectRepr(const std::shared_ptr<model::LostObject> lost_object) : id_(lost_object->GetId()), type_(lost_object->GetType()), position_(lost_object->GetPosition()), value_(lost_object->GetValue()) {
+LostObjectRepr::LostObjectRepr(const model::LostObject& lost_object) : id_(lost_object.GetId()), type_(lost_object.GetType()), position_(lost_object.GetPosition()), value_(lost_object.GetValue()) {
 }
 
-[[nodiscard]] std::shared_ptr<model::LostObject> LostObjectRepr::Restore() const {
-    return std::make_shared<model::LostObject>(id_, type_, position_, value_);
+[[nodiscard]] model::LostObject LostObjectRepr::Restore() const {
+    return model::LostObject{id_, type_, position_, value_};
 }
 
 PlayerRepr::PlayerRepr(const std::shared_ptr<Player> player, const Token& token) : id_(*player->GetId()), dog_(player->GetDog()), token_(*token) {
@@ -38,7 +38,7 @@ GameSessionRepr::GameSessionRepr(
     const std::vector<std::pair<Token, std::shared_ptr<Player>>>& tokenToPlayer)
     : id_(game_session->GetId()), map_id_(*(game_session->GetMap()->GetId())) {
     players_ser_.reserve(tokenToPlayer.size());
-    lost_objects_.reserve(game_session->GetLostObjects().size());
+    lost_objects_.reserve(game_session->GetLostObjects().Size());
 
     std::ranges::transform(tokenToPlayer, std::back_inserter(players_ser_),
                            [](const auto& token_to_player) -> PlayerRepr {
@@ -46,8 +46,8 @@ GameSessionRepr::GameSessionRepr(
                            });
 
     std::ranges::transform(game_session->GetLostObjects(), std::back_inserter(lost_objects_),
-                           [](const auto& id_to_lost_object) -> LostObjectRepr {
-                               return LostObjectRepr{id_to_lost_object.second};
+                           [](const auto& lost_object) -> LostObjectRepr {
+                               return LostObjectRepr{lost_object};
                            });
 };
 
@@ -66,8 +66,8 @@ class DogRepr {
 class LostObjectRepr {
    public:
     LostObjectRepr() = default;
-    explicit LostObjectRepr(const std::shared_ptr<model::LostObject> lost_object);
-    [[nodiscard]] std::shared_ptr<model::LostObject> Restore() const;
+    explicit LostObjectRepr(const model::LostObject& lost_object);
+    [[nodiscard]] model::LostObject Restore() const;
 
     template <typename Archive>
     void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
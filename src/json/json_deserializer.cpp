@@ -106,7 +106,7 @@ model::Map MakeMap(std::string id, std::string name, double dog_speed, uint64_t
     return model::Map{model::Map::Id{id}, name, dog_speed, bag_capacity};
 }
 
-model::Map ExtractMap(json::value map, double dog_speed, uint64_t bag_capacity) {
+model::Map ExtractMap(json::value map, double dog_speed, uint64_t bag_capacity, size_t max_players_per_session) {
     auto id = map.at(Key::ID).as_string().c_str();
     auto name = map.at(Key::NAME).as_string().c_str();
     if (map.as_object().contains(Key::DOG_SPEED))
@@ -115,7 +115,11 @@ model::Map ExtractMap(json::value map, double dog_speed, uint64_t bag_capacity)
     if (map.as_object().contains(Key::BAG_CAPACITY))
         bag_capacity = map.at(Key::BAG_CAPACITY).as_uint64();
 
+    if (map.as_object().contains(Key::MAX_PLAYERS_PER_SESSION))
+        max_players_per_session = map.at(Key::MAX_PLAYERS_PER_SESSION).as_uint64();
+
     model::Map out = MakeMap(id, name, dog_speed, bag_capacity);
+    out.SetMaxPlayersPerSession(max_players_per_session);
 
     for (auto it = map.at(Key::LOOT_TYPES).as_array().begin();
          it != map.at(Key::LOOT_TYPES).as_array().end(); ++it)
@@ -181,6 +185,10 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
     if (value.as_object().contains(Key::DEFAULT_BAG_CAPACITY))
         bag_capacity = value.as_object().at(Key::DEFAULT_BAG_CAPACITY).as_uint64();
 
+    size_t max_players_per_session = model::DEFAULT_MAX_PLAYERS_PER_SESSION;
+    if (value.as_object().contains(Key::MAX_PLAYERS_PER_SESSION))
+        max_players_per_session = value.as_object().at(Key::MAX_PLAYERS_PER_SESSION).as_uint64();
+
     if (value.as_object().contains(Key::DOG_RETIREMENT_TIME))
         model::Dog::SetMaxInactiveTime(boost::json::value_to<size_t>(value.as_object().at(Key::DOG_RETIREMENT_TIME)));
 
@@ -188,7 +196,7 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
     game.SetLootGeneratorConfig(loot_generator_config);
     for (auto it = value.as_object().at(Key::MAPS).as_array().begin();
          it != value.as_object().at(Key::MAPS).as_array().end(); ++it)
-        game.AddMap(ExtractMap(*it, dog_speed, bag_capacity));
+        game.AddMap(ExtractMap(*it, dog_speed, bag_capacity, max_players_per_session));
 
     return game;
 }
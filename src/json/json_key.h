@@ -43,11 +43,16 @@ struct Key {
     constexpr static auto LOST_OBJECTS{"lostObjects"};
     constexpr static auto DEFAULT_BAG_CAPACITY{"defaultBagCapacity"};
     constexpr static auto BAG_CAPACITY{"bagCapacity"};
+    constexpr static auto MAX_PLAYERS_PER_SESSION{"maxPlayersPerSession"};
     constexpr static auto BAG{"bag"};
     constexpr static auto VALUE{"value"};
     constexpr static auto SCORE{"score"};
     constexpr static auto PLAY_TIME{"playTime"};
     constexpr static auto DOG_RETIREMENT_TIME{"dogRetirementTime"};
+    constexpr static auto TICK{"tick"};
+    constexpr static auto SINCE{"since"};
+    constexpr static auto REMOVED_PLAYERS{"removedPlayers"};
+    constexpr static auto REMOVED_LOST_OBJECTS{"removedLostObjects"};
 };
 
 struct ErrorKey {
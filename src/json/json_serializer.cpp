@@ -163,7 +163,7 @@ std::string SerializeListOfPlayers(std::vector<PlayerInfo> players) {
     return json::serialize(out_json);
 }
 
-json::array SerializePlayersBag(const PlayerState::Bag& bag) {
+json::array SerializePlayersBag(const model::Dog::Bag& bag) {
     json::array bags_json;
 
     for (const auto& item : bag) {
@@ -176,41 +176,84 @@ json::array SerializePlayersBag(const PlayerState::Bag& bag) {
     return bags_json;
 }
 
-json::value SerializePlayersStates(const GameState::PlayersStates& players) {
+void SerializePlayerState(json::object& players_json, const GameSession::Snapshot::DogState& player) {
+    // Пёс без игрока в ответ не попадает
+    if (!player.owner_id) {
+        return;
+    }
+    players_json.insert_or_assign(
+        std::to_string(*player.owner_id),
+        json::object{
+            {Key::POSITION, json::array{player.position.x, player.position.y}},
+            {Key::SPEED, json::array{player.speed.x, player.speed.y}},
+            {Key::DIRECTION, std::string{static_cast<char>(player.direction)}},
+            {Key::BAG, SerializePlayersBag(*player.bag)},
+            {Key::SCORE, player.score},
+        });
+}
+
+void SerializeLostObjectState(json::object& lost_objects_json, const GameSession::Snapshot::LostObjectState& lost_object) {
+    lost_objects_json.insert_or_assign(
+        std::to_string(*lost_object.id),
+        json::object{
+            {Key::TYPE, lost_object.type},
+            {Key::POSITION, json::array{lost_object.position.x, lost_object.position.y}}});
+}
+
+json::value SerializePlayersStates(const std::vector<GameSession::Snapshot::DogState>& players) {
     json::object players_json;
     for (const auto& player : players) {
-        players_json.insert_or_assign(
-            std::to_string(*player.id),
-            json::object{
-                {Key::POSITION, json::array{player.position.x, player.position.y}},
-                {Key::SPEED, json::array{player.speed.x, player.speed.y}},
-                {Key::DIRECTION, std::string{static_cast<char>(player.direction)}},
-                {Key::BAG, SerializePlayersBag(player.bag)},
-                {Key::SCORE, player.score},
-            });
+        SerializePlayerState(players_json, player);
     }
     return players_json;
 }
 
-json::value SerializeLostObjectsStates(const GameState::LostObjectsStates& lost_objects) {
+json::value SerializeLostObjectsStates(const GameSession::Snapshot::LostObjectStates& lost_objects) {
     json::object lost_objects_json;
     for (const auto& lost_object : lost_objects) {
-        lost_objects_json.insert_or_assign(
-            std::to_string(*lost_object.id),
-            json::object{
-                {Key::TYPE, lost_object.type},
-                {Key::POSITION, json::array{lost_object.position.x, lost_object.position.y}}});
+        SerializeLostObjectState(lost_objects_json, lost_object);
     }
     return lost_objects_json;
 }
 
-std::string SerializeGameState(GameState game_state) {
-    std::string test = json::serialize(json::object{
-        {Key::PLAYERS, SerializePlayersStates(game_state.players)},
-        {Key::LOST_OBJECTS, SerializeLostObjectsStates(game_state.lost_objects)}});
+std::string SerializeGameState(const GameSession::Snapshot& game_state) {
+    return json::serialize(json::object{
+        {Key::PLAYERS, SerializePlayersStates(game_state.dogs)},
+        {Key::LOST_OBJECTS, SerializeLostObjectsStates(*game_state.lost_objects)}});
+}
+
+std::string SerializeGameStateResync(const GameSession::Snapshot& game_state) {
+    return json::serialize(json::object{
+        {Key::TICK, game_state.tick},
+        {Key::PLAYERS, SerializePlayersStates(game_state.dogs)},
+        {Key::LOST_OBJECTS, SerializeLostObjectsStates(*game_state.lost_objects)}});
+}
+
+std::string SerializeGameStateDelta(const GameSession::Snapshot& game_state, uint64_t since,
+                                    const GameSession::Snapshot::Delta& delta) {
+    json::object players_json;
+    for (const auto* player : delta.changed_dogs) {
+        SerializePlayerState(players_json, *player);
+    }
+    json::object lost_objects_json;
+    for (const auto* lost_object : delta.added_lost_objects) {
+        SerializeLostObjectState(lost_objects_json, *lost_object);
+    }
+    json::array removed_players_json;
+    for (const auto owner_id : delta.removed_owners) {
+        removed_players_json.push_back(owner_id);
+    }
+    json::array removed_lost_objects_json;
+    for (const auto& id : delta.removed_lost_objects) {
+        removed_lost_objects_json.push_back(*id);
+    }
     return json::serialize(json::object{
-        {Key::PLAYERS, SerializePlayersStates(game_state.players)},
-        {Key::LOST_OBJECTS, SerializeLostObjectsStates(game_state.lost_objects)}});
+        {Key::TICK, game_state.tick},
+        {Key::SINCE, since},
+        {Key::PLAYERS, std::move(players_json)},
+        {Key::LOST_OBJECTS, std::move(lost_objects_json)},
+        {Key::REMOVED_PLAYERS, std::move(removed_players_json)},
+        {Key::REMOVED_LOST_OBJECTS, std::move(removed_lost_objects_json)}});
 }
 
 std::string ErrorMsg(std::string code, std::string message) {
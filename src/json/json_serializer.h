@@ -11,7 +11,12 @@ std::string Serialize(const model::Game::Maps& maps);
 std::string SerializeListOfMaps(const ListMapsUseCase::Maps& maps);
 std::string JoinGame(std::string authToken, std::string playerId);
 std::string SerializeListOfPlayers(std::vector<PlayerInfo> players);
-std::string SerializeGameState(GameState game_state);
+std::string SerializeGameState(const GameSession::Snapshot& game_state);
+// Полное состояние с номером тика - ответ клиенту, отставшему больше чем на историю снимка
+std::string SerializeGameStateResync(const GameSession::Snapshot& game_state);
+// Только изменившиеся с тика since игроки и предметы
+std::string SerializeGameStateDelta(const GameSession::Snapshot& game_state, uint64_t since,
+                                    const GameSession::Snapshot::Delta& delta);
 std::string SerializeRecords(RecordUseCase::Records records);
 
 std::string ErrorMsg(std::string code, std::string message);
@@ -40,6 +40,7 @@ struct Args {
     fs::path config_json_path;
     fs::path static_files_root;
     std::optional<std::chrono::milliseconds> tick_period;
+    size_t max_catch_up_ticks = GameSession::DEFAULT_MAX_CATCH_UP_TICKS;
     bool randomize_spawn_points = false;
     std::optional<fs::path> state_file_path;
     std::optional<std::chrono::milliseconds> state_period = std::nullopt;
@@ -50,9 +51,10 @@ struct Args {
 
     po::options_description desc{"Allowed options"};
     unsigned tick_period = 0;
+    unsigned max_catch_up_ticks = 0;
     std::string config_json_path, static_files_root, state_file_path;
     unsigned state_period = 0;
-    desc.add_options()("help,h", "produce help message")("tick-period,t", po::value<unsigned>(&tick_period)->value_name("milliseconds"s), "set tick period")("config-file,c", po::value<std::string>(&config_json_path)->value_name("file"s), "set config file path")("www-root,w", po::value<std::string>(&static_files_root)->value_name("dir"s), "set static files root")("randomize-spawn-points", "spawn dogs at random positions")("state-file", po::value<std::string>(&state_file_path)->value_name("file"s))("save-state-period", po::value<unsigned>(&state_period)->value_name("milliseconds"s));
+    desc.add_options()("help,h", "produce help message")("tick-period,t", po::value<unsigned>(&tick_period)->value_name("milliseconds"s), "set tick period")("max-catch-up-ticks", po::value<unsigned>(&max_catch_up_ticks)->value_name("ticks"s), "set max ticks run at once to catch up with real time")("config-file,c", po::value<std::string>(&config_json_path)->value_name("file"s), "set config file path")("www-root,w", po::value<std::string>(&static_files_root)->value_name("dir"s), "set static files root")("randomize-spawn-points", "spawn dogs at random positions")("state-file", po::value<std::string>(&state_file_path)->value_name("file"s))("save-state-period", po::value<unsigned>(&state_period)->value_name("milliseconds"s));
 
     po::positional_options_description p;
     p.add("config-file", 1).add("www-root", 1);
@@ -72,6 +74,12 @@ struct Args {
         }
         args.tick_period = std::chrono::milliseconds{tick_period};
     }
+    if (vm.contains("max-catch-up-ticks"s)) {
+        if (max_catch_up_ticks == 0) {
+            throw std::runtime_error{"Invalid max-catch-up-ticks"s};
+        }
+        args.max_catch_up_ticks = max_catch_up_ticks;
+    }
     if (vm.contains("www-root"s)) {
         args.static_files_root = static_files_root;
     } else {
@@ -114,8 +122,9 @@ int main(int argc, const char* argv[]) {
         DbConnectrioSettings db_settings{num_threads, std::move(db_url)};
         // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
         // Подписываемся на сигналы и при их получении завершаем работу сервера
-        auto app = std::make_shared<Application>(game, args->randomize_spawn_points, ioc, args->tick_period, args->state_file_path, args->state_period, std::move(db_settings));
+        auto app = std::make_shared<Application>(game, args->randomize_spawn_points, ioc, args->tick_period, args->max_catch_up_ticks, args->state_file_path, args->state_period, std::move(db_settings));
         app->RestoreGame();
+        app->Run();
         net::signal_set signals(ioc, SIGINT, SIGTERM);
         signals.async_wait([&ioc, app](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
             if (!ec) {
@@ -129,8 +138,7 @@ int main(int argc, const char* argv[]) {
         // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
         std::filesystem::path root = args->static_files_root;
         root = std::filesystem::canonical(root);
-        auto strand = net::make_strand(ioc);
-        auto handler = std::make_shared<http_handler::RequestHandler>(app, root, strand);
+        auto handler = std::make_shared<http_handler::RequestHandler>(app, root);
 
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         const auto address = net::ip::make_address("0.0.0.0"sv);
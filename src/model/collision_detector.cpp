@@ -1,9 +1,88 @@
 #include "collision_detector.h"
 
 #include <cassert>
+#include <cmath>
+#include <tuple>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace collision_detector {
 
+namespace {
+
+// Запас, на который расширяется область запроса к индексу, чтобы ошибки округления
+// в TryCollectPoint не приводили к расхождению с полным перебором
+constexpr double QUERY_EPSILON = 1e-6;
+
+// Ограничение на число ячеек относительно числа предметов,
+// чтобы разреженная сцена с далёкими предметами не порождала огромную сетку
+constexpr size_t MAX_CELLS_PER_ITEM = 4;
+
+// Размер порции предметов, для которой CollectBatch держит промежуточные результаты на стеке
+constexpr size_t BATCH_CHUNK_SIZE = 64;
+
+}  // namespace
+
+namespace detail {
+
+void SortByTime(std::vector<GatheringEvent>& events) {
+    // События добавляются по возрастанию (gatherer_id, item_id), поэтому сортировка по полному
+    // ключу совпадает с устойчивой сортировкой по времени, но не выделяет временный буфер
+    std::sort(events.begin(), events.end(), [](const GatheringEvent& lhs, const GatheringEvent& rhs) {
+        return std::tie(lhs.time, lhs.gatherer_id, lhs.item_id) < std::tie(rhs.time, rhs.gatherer_id, rhs.item_id);
+    });
+}
+
+void CollectFromIndex(const ItemGrid& grid, const Gatherer& gatherer, size_t gatherer_id,
+                      std::vector<size_t>& candidates, std::vector<GatheringEvent>& events) {
+    if (!IsMoving(gatherer)) {
+        return;
+    }
+    const auto& items = grid.GetItems();
+    grid.FindCandidates(gatherer.start_pos, gatherer.end_pos, gatherer.width, candidates);
+    for (size_t i : candidates) {
+        auto collect_result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, {items.xs[i], items.ys[i]});
+        if (collect_result.IsCollected(items.widths[i] + gatherer.width)) {
+            events.push_back({i, gatherer_id, collect_result.sq_distance, collect_result.proj_ratio});
+        }
+    }
+}
+
+void CollectFromIndex(const AxisSweepIndex& index, const Gatherer& gatherer, size_t gatherer_id,
+                      std::vector<size_t>& candidates, std::vector<GatheringEvent>& events) {
+    if (!IsMoving(gatherer)) {
+        return;
+    }
+    const auto& items = index.GetItems();
+    if (!index.FindCandidates(gatherer.start_pos, gatherer.end_pos, gatherer.width, candidates)) {
+        CollectBatch(items, gatherer, gatherer_id, events);
+        return;
+    }
+    for (size_t i : candidates) {
+        auto collect_result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, {items.xs[i], items.ys[i]});
+        if (collect_result.IsCollected(items.widths[i] + gatherer.width)) {
+            events.push_back({i, gatherer_id, collect_result.sq_distance, collect_result.proj_ratio});
+        }
+    }
+}
+
+void MergeSortedRuns(std::vector<GatheringEvent>& events, const std::vector<size_t>& bounds) {
+    // std::inplace_merge устойчив: при равном времени левый диапазон идёт первым,
+    // что совпадает с порядком устойчивой сортировки всего массива
+    for (size_t run = 2; run < bounds.size(); ++run) {
+        std::inplace_merge(events.begin(), events.begin() + bounds[run - 1], events.begin() + bounds[run],
+                           [](const GatheringEvent& lhs, const GatheringEvent& rhs) {
+                               return lhs.time < rhs.time;
+                           });
+    }
+}
+
+}  // namespace detail
+
 CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c) {
     // Проверим, что перемещение ненулевое.
     // Тут приходится использовать строгое равенство, а не приближённое,
@@ -23,29 +102,272 @@ CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D
     return CollectionResult(sq_distance, proj_ratio);
 }
 
-// В задании на разработку тестов реализовывать следующую функцию не нужно -
-// она будет линковаться извне.
+void TryCollectPoints(geom::Point2D a, geom::Point2D b, const double* xs, const double* ys, size_t count,
+                      double* sq_distances, double* proj_ratios) {
+    assert(b.x != a.x || b.y != a.y);
+    size_t i = 0;
+    // Векторные ветки повторяют порядок операций TryCollectPoint,
+    // поэтому результаты совпадают с поэлементным вызовом
+#if defined(__AVX__)
+    const __m256d a_x = _mm256_set1_pd(a.x);
+    const __m256d a_y = _mm256_set1_pd(a.y);
+    const __m256d v_x = _mm256_set1_pd(b.x - a.x);
+    const __m256d v_y = _mm256_set1_pd(b.y - a.y);
+    const __m256d v_len2 = _mm256_add_pd(_mm256_mul_pd(v_x, v_x), _mm256_mul_pd(v_y, v_y));
+    for (; i + 4 <= count; i += 4) {
+        const __m256d u_x = _mm256_sub_pd(_mm256_loadu_pd(xs + i), a_x);
+        const __m256d u_y = _mm256_sub_pd(_mm256_loadu_pd(ys + i), a_y);
+        const __m256d u_dot_v = _mm256_add_pd(_mm256_mul_pd(u_x, v_x), _mm256_mul_pd(u_y, v_y));
+        const __m256d u_len2 = _mm256_add_pd(_mm256_mul_pd(u_x, u_x), _mm256_mul_pd(u_y, u_y));
+        _mm256_storeu_pd(proj_ratios + i, _mm256_div_pd(u_dot_v, v_len2));
+        _mm256_storeu_pd(sq_distances + i,
+                         _mm256_sub_pd(u_len2, _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), v_len2)));
+    }
+#elif defined(__SSE2__)
+    const __m128d a_x = _mm_set1_pd(a.x);
+    const __m128d a_y = _mm_set1_pd(a.y);
+    const __m128d v_x = _mm_set1_pd(b.x - a.x);
+    const __m128d v_y = _mm_set1_pd(b.y - a.y);
+    const __m128d v_len2 = _mm_add_pd(_mm_mul_pd(v_x, v_x), _mm_mul_pd(v_y, v_y));
+    for (; i + 2 <= count; i += 2) {
+        const __m128d u_x = _mm_sub_pd(_mm_loadu_pd(xs + i), a_x);
+        const __m128d u_y = _mm_sub_pd(_mm_loadu_pd(ys + i), a_y);
+        const __m128d u_dot_v = _mm_add_pd(_mm_mul_pd(u_x, v_x), _mm_mul_pd(u_y, v_y));
+        const __m128d u_len2 = _mm_add_pd(_mm_mul_pd(u_x, u_x), _mm_mul_pd(u_y, u_y));
+        _mm_storeu_pd(proj_ratios + i, _mm_div_pd(u_dot_v, v_len2));
+        _mm_storeu_pd(sq_distances + i, _mm_sub_pd(u_len2, _mm_div_pd(_mm_mul_pd(u_dot_v, u_dot_v), v_len2)));
+    }
+#endif
+    for (; i < count; ++i) {
+        const auto result = TryCollectPoint(a, b, {xs[i], ys[i]});
+        sq_distances[i] = result.sq_distance;
+        proj_ratios[i] = result.proj_ratio;
+    }
+}
 
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
-    std::vector<GatheringEvent> result;
-    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
-        for (size_t i = 0; i < provider.ItemsCount(); ++i) {
-            auto gatherer = provider.GetGatherer(g);
-            auto item = provider.GetItem(i);
-            if ((!(gatherer.end_pos.x != gatherer.start_pos.x || gatherer.end_pos.y != gatherer.start_pos.y))) {
-                continue;
-            }
-            auto collect_result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.GetPosition());
-            if (collect_result.IsCollected(item.GetWidth() + gatherer.width)) {
-                result.push_back({i, g, collect_result.sq_distance, collect_result.proj_ratio});
+void CollectBatch(const ItemBatch& items, const Gatherer& gatherer, size_t gatherer_id,
+                  std::vector<GatheringEvent>& events) {
+    double sq_distances[BATCH_CHUNK_SIZE];
+    double proj_ratios[BATCH_CHUNK_SIZE];
+    const size_t count = items.Size();
+    for (size_t first = 0; first < count; first += BATCH_CHUNK_SIZE) {
+        const size_t chunk = std::min(BATCH_CHUNK_SIZE, count - first);
+        TryCollectPoints(gatherer.start_pos, gatherer.end_pos, items.xs.data() + first, items.ys.data() + first,
+                         chunk, sq_distances, proj_ratios);
+        for (size_t k = 0; k < chunk; ++k) {
+            const CollectionResult collect_result{sq_distances[k], proj_ratios[k]};
+            if (collect_result.IsCollected(items.widths[first + k] + gatherer.width)) {
+                events.push_back({first + k, gatherer_id, sq_distances[k], proj_ratios[k]});
             }
         }
     }
-    sort(result.begin(), result.end(),
-         [](const GatheringEvent& lhs, const GatheringEvent& rhs) {
-             return lhs.time < rhs.time;
-         });
-    return result;
+}
+
+ItemGrid::ItemGrid(double cell_size)
+    : base_cell_size_{cell_size}, cell_size_{cell_size} {
+    assert(cell_size_ > 0.0);
+}
+
+void ItemGrid::Index() {
+    const size_t items_count = items_.Size();
+    max_item_width_ = 0.0;
+    double max_x = 0.0;
+    double max_y = 0.0;
+    for (size_t i = 0; i < items_count; ++i) {
+        const double x = items_.xs[i];
+        const double y = items_.ys[i];
+        if (i == 0) {
+            min_x_ = max_x = x;
+            min_y_ = max_y = y;
+        } else {
+            min_x_ = std::min(min_x_, x);
+            min_y_ = std::min(min_y_, y);
+            max_x = std::max(max_x, x);
+            max_y = std::max(max_y, y);
+        }
+        max_item_width_ = std::max(max_item_width_, items_.widths[i]);
+    }
+
+    cell_size_ = base_cell_size_;
+    const size_t max_cells = MAX_CELLS_PER_ITEM * items_count + 1;
+    auto cells_along = [this](double extent) {
+        return static_cast<size_t>(extent / cell_size_) + 1;
+    };
+    while (cells_along(max_x - min_x_) * cells_along(max_y - min_y_) > max_cells) {
+        cell_size_ *= 2.0;
+    }
+    cols_ = cells_along(max_x - min_x_);
+    rows_ = cells_along(max_y - min_y_);
+
+    // Раскладываем индексы предметов по ячейкам подсчётом (CSR)
+    cell_starts_.assign(cols_ * rows_ + 1, 0);
+    for (size_t i = 0; i < items_count; ++i) {
+        ++cell_starts_[CellY(items_.ys[i]) * cols_ + CellX(items_.xs[i]) + 1];
+    }
+    for (size_t c = 1; c < cell_starts_.size(); ++c) {
+        cell_starts_[c] += cell_starts_[c - 1];
+    }
+    cell_items_.resize(items_count);
+    cell_fill_.assign(cell_starts_.begin(), cell_starts_.end() - 1);
+    for (size_t i = 0; i < items_count; ++i) {
+        cell_items_[cell_fill_[CellY(items_.ys[i]) * cols_ + CellX(items_.xs[i])]++] = i;
+    }
+}
+
+void ItemGrid::FindCandidates(geom::Point2D a, geom::Point2D b, double radius,
+                              std::vector<size_t>& candidates) const {
+    candidates.clear();
+    if (items_.Size() == 0) {
+        return;
+    }
+    const double reach = radius + max_item_width_ + QUERY_EPSILON;
+    const double left = std::min(a.x, b.x) - reach;
+    const double right = std::max(a.x, b.x) + reach;
+    const double top = std::min(a.y, b.y) - reach;
+    const double bottom = std::max(a.y, b.y) + reach;
+    if (right < min_x_ || bottom < min_y_) {
+        return;
+    }
+
+    const size_t x0 = CellX(left);
+    const size_t x1 = CellX(right);
+    const size_t y0 = CellY(top);
+    const size_t y1 = CellY(bottom);
+    for (size_t y = y0; y <= y1; ++y) {
+        for (size_t x = x0; x <= x1; ++x) {
+            const size_t cell = y * cols_ + x;
+            candidates.insert(candidates.end(), cell_items_.begin() + cell_starts_[cell],
+                              cell_items_.begin() + cell_starts_[cell + 1]);
+        }
+    }
+    // Сохраняем порядок полного перебора, чтобы результаты совпадали
+    std::sort(candidates.begin(), candidates.end());
+}
+
+const ItemBatch& ItemGrid::GetItems() const noexcept {
+    return items_;
+}
+
+double ItemGrid::GetCellSize() const noexcept {
+    return base_cell_size_;
+}
+
+size_t ItemGrid::CellX(double x) const noexcept {
+    if (x <= min_x_) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>((x - min_x_) / cell_size_), cols_ - 1);
+}
+
+size_t ItemGrid::CellY(double y) const noexcept {
+    if (y <= min_y_) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>((y - min_y_) / cell_size_), rows_ - 1);
+}
+
+void AxisSweepIndex::Lines::Build(const std::vector<double>& key_coords, const std::vector<double>& along_coords) {
+    const size_t count = key_coords.size();
+    keys.clear();
+    starts.clear();
+    alongs.resize(count);
+    items.resize(count);
+    if (count == 0) {
+        starts.push_back(0);
+        return;
+    }
+
+    // Раскладываем предметы подсчётом по корзинам, монотонно зависящим от key,
+    // и досортировываем каждую корзину. Это дешевле сортировки всего массива
+    const auto [min_key, max_key] = std::minmax_element(key_coords.begin(), key_coords.end());
+    const double key_range = *max_key - *min_key;
+    const size_t buckets_count = key_range > 0.0 ? count : 1;
+    const double scale = key_range > 0.0 ? (buckets_count - 1) / key_range : 0.0;
+    auto bucket_of = [&, min_key = *min_key](double key) {
+        return std::min(static_cast<size_t>((key - min_key) * scale), buckets_count - 1);
+    };
+    bucket_starts.assign(buckets_count + 1, 0);
+    for (double key : key_coords) {
+        ++bucket_starts[bucket_of(key) + 1];
+    }
+    for (size_t b = 1; b <= buckets_count; ++b) {
+        bucket_starts[b] += bucket_starts[b - 1];
+    }
+    entries.resize(count);
+    fill.assign(bucket_starts.begin(), bucket_starts.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        entries[fill[bucket_of(key_coords[i])]++] = {key_coords[i], along_coords[i], i};
+    }
+    // Порядок предметов в одной точке не важен: кандидаты потом упорядочиваются по индексу
+    for (size_t b = 0; b < buckets_count; ++b) {
+        std::sort(entries.begin() + bucket_starts[b], entries.begin() + bucket_starts[b + 1],
+                  [](const Entry& lhs, const Entry& rhs) {
+                      return lhs.key != rhs.key ? lhs.key < rhs.key : lhs.along < rhs.along;
+                  });
+    }
+
+    keys.reserve(count);
+    starts.reserve(count + 1);
+    for (size_t k = 0; k < count; ++k) {
+        if (keys.empty() || keys.back() != entries[k].key) {
+            keys.push_back(entries[k].key);
+            starts.push_back(k);
+        }
+        alongs[k] = entries[k].along;
+        items[k] = entries[k].item;
+    }
+    starts.push_back(count);
+}
+
+void AxisSweepIndex::Lines::Query(double key_min, double key_max, double along_min, double along_max,
+                                  std::vector<size_t>& candidates) const {
+    for (auto key = std::lower_bound(keys.begin(), keys.end(), key_min); key != keys.end() && *key <= key_max; ++key) {
+        const size_t line = key - keys.begin();
+        const auto first = alongs.begin() + starts[line];
+        const auto last = alongs.begin() + starts[line + 1];
+        for (auto along = std::lower_bound(first, last, along_min); along != last && *along <= along_max; ++along) {
+            candidates.push_back(items[along - alongs.begin()]);
+        }
+    }
+}
+
+void AxisSweepIndex::Index() {
+    max_item_width_ = 0.0;
+    for (double width : items_.widths) {
+        max_item_width_ = std::max(max_item_width_, width);
+    }
+    rows_.Build(items_.ys, items_.xs);
+    columns_.Build(items_.xs, items_.ys);
+}
+
+bool AxisSweepIndex::FindCandidates(geom::Point2D a, geom::Point2D b, double radius,
+                                    std::vector<size_t>& candidates) const {
+    const bool horizontal = a.y == b.y;
+    if (!horizontal && a.x != b.x) {
+        return false;
+    }
+    candidates.clear();
+    const double reach = radius + max_item_width_ + QUERY_EPSILON;
+    if (horizontal) {
+        rows_.Query(a.y - reach, a.y + reach, std::min(a.x, b.x) - reach, std::max(a.x, b.x) + reach, candidates);
+    } else {
+        columns_.Query(a.x - reach, a.x + reach, std::min(a.y, b.y) - reach, std::max(a.y, b.y) + reach, candidates);
+    }
+    // Сохраняем порядок полного перебора, чтобы результаты совпадали
+    std::sort(candidates.begin(), candidates.end());
+    return true;
+}
+
+const ItemBatch& AxisSweepIndex::GetItems() const noexcept {
+    return items_;
+}
+
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
+    return FindGatherEvents<ItemGathererProvider>(provider);
+}
+
+std::vector<GatheringEvent> FindGatherEventsGrid(const ItemGathererProvider& provider, double cell_size) {
+    return FindGatherEventsGrid<ItemGathererProvider>(provider, cell_size);
 }
 
 }  // namespace collision_detector
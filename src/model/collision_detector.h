@@ -1,6 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <functional>
+#include <latch>
+#include <memory>
 #include <vector>
 
 #include "geom.h"
@@ -73,6 +78,392 @@ struct GatheringEvent {
     double time;
 };
 
+/*
+ * Требования к провайдеру предметов и собирателей, проверяемые при компиляции.
+ * Шаблонные функции поиска вызывают методы провайдера напрямую, что позволяет
+ * компилятору их встроить. ItemGathererProvider тоже удовлетворяет этим требованиям.
+ */
+template <typename Provider>
+concept GathererProvider = requires(const Provider& provider, size_t idx) {
+    { provider.ItemsCount() } -> std::convertible_to<size_t>;
+    { provider.GetItem(idx).GetPosition() } -> std::convertible_to<geom::Point2D>;
+    { provider.GetItem(idx).GetWidth() } -> std::convertible_to<double>;
+    { provider.GatherersCount() } -> std::convertible_to<size_t>;
+    { provider.GetGatherer(idx) } -> std::convertible_to<Gatherer>;
+};
+
+/*
+ * Предметы в виде структуры массивов: координаты и ширины лежат в отдельных
+ * непрерывных массивах, что позволяет обрабатывать сразу несколько предметов
+ * одной SIMD-инструкцией.
+ */
+struct ItemBatch {
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<double> widths;
+
+    size_t Size() const noexcept {
+        return xs.size();
+    }
+
+    void Clear() noexcept {
+        xs.clear();
+        ys.clear();
+        widths.clear();
+    }
+
+    void Reserve(size_t count) {
+        xs.reserve(count);
+        ys.reserve(count);
+        widths.reserve(count);
+    }
+
+    void Add(geom::Point2D position, double width) {
+        xs.push_back(position.x);
+        ys.push_back(position.y);
+        widths.push_back(width);
+    }
+
+    template <GathererProvider Provider>
+    void Load(const Provider& provider) {
+        const size_t count = provider.ItemsCount();
+        Clear();
+        Reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const auto& item = provider.GetItem(i);
+            Add(item.GetPosition(), item.GetWidth());
+        }
+    }
+};
+
+// Пакетный вариант TryCollectPoint для count точек (xs[i], ys[i]).
+// Результаты побитово совпадают с результатами TryCollectPoint.
+void TryCollectPoints(geom::Point2D a, geom::Point2D b, const double* xs, const double* ys, size_t count,
+                      double* sq_distances, double* proj_ratios);
+
+// Дописывает в events события сбора предметов пакета собирателем с индексом gatherer_id
+// в порядке возрастания индекса предмета. Собиратель должен двигаться.
+void CollectBatch(const ItemBatch& items, const Gatherer& gatherer, size_t gatherer_id,
+                  std::vector<GatheringEvent>& events);
+
+constexpr double DEFAULT_GRID_CELL_SIZE = 4.0;
+
+/*
+ * Равномерная сетка над позициями предметов (широкая фаза поиска столкновений).
+ * Индексы предметов хранятся в одном непрерывном буфере, сгруппированными по ячейкам,
+ * внутри ячейки - по возрастанию индекса.
+ */
+class ItemGrid {
+   public:
+    explicit ItemGrid(double cell_size = DEFAULT_GRID_CELL_SIZE);
+
+    template <GathererProvider Provider>
+    void Build(const Provider& provider) {
+        items_.Load(provider);
+        Index();
+    }
+
+    // Добавляет в candidates индексы предметов из ячеек, задетых прямоугольником,
+    // описанным вокруг отрезка ab и расширенным на radius + максимальную ширину предмета.
+    // Результат упорядочен по возрастанию индекса.
+    void FindCandidates(geom::Point2D a, geom::Point2D b, double radius, std::vector<size_t>& candidates) const;
+
+    const ItemBatch& GetItems() const noexcept;
+    double GetCellSize() const noexcept;
+
+   private:
+    void Index();
+    size_t CellX(double x) const noexcept;
+    size_t CellY(double y) const noexcept;
+
+    double base_cell_size_;
+    double cell_size_;
+    double min_x_ = 0.0;
+    double min_y_ = 0.0;
+    size_t cols_ = 0;
+    size_t rows_ = 0;
+    double max_item_width_ = 0.0;
+    ItemBatch items_;
+    // cell_starts_[c]..cell_starts_[c + 1] - диапазон индексов ячейки c в cell_items_
+    std::vector<size_t> cell_starts_;
+    std::vector<size_t> cell_items_;
+    // Позиции заполнения ячеек при раскладке, хранятся между вызовами Build
+    std::vector<size_t> cell_fill_;
+};
+
+/*
+ * Индекс для собирателей, движущихся вдоль осей: собаки ходят только по горизонтальным
+ * и вертикальным дорогам. Предметы сгруппированы в ряды с одинаковой координатой y
+ * и в столбцы с одинаковой координатой x, внутри ряда (столбца) упорядочены по второй координате.
+ * Горизонтальный отрезок превращается в двоичный поиск рядов в полосе вокруг него
+ * и интервала x внутри каждого ряда. Предметы лежат на осях дорог, поэтому рядов в полосе мало.
+ */
+class AxisSweepIndex {
+   public:
+    template <GathererProvider Provider>
+    void Build(const Provider& provider) {
+        items_.Load(provider);
+        Index();
+    }
+
+    // Для горизонтального или вертикального отрезка ab заполняет candidates индексами предметов,
+    // до которых может быть не дальше radius + максимальная ширина предмета, по возрастанию индекса.
+    // Для отрезка, не параллельного осям, возвращает false.
+    bool FindCandidates(geom::Point2D a, geom::Point2D b, double radius, std::vector<size_t>& candidates) const;
+
+    const ItemBatch& GetItems() const noexcept;
+
+   private:
+    // Группы предметов с одинаковой координатой key, упорядоченные по координате along
+    struct Lines {
+        struct Entry {
+            double key;
+            double along;
+            size_t item;
+        };
+
+        std::vector<double> keys;
+        // starts[l]..starts[l + 1] - диапазон линии l в alongs и items
+        std::vector<size_t> starts;
+        std::vector<double> alongs;
+        std::vector<size_t> items;
+        // Буферы сортировки корзинами, переиспользуемые между построениями
+        std::vector<size_t> bucket_starts;
+        std::vector<Entry> entries;
+        std::vector<size_t> fill;
+
+        void Build(const std::vector<double>& key_coords, const std::vector<double>& along_coords);
+        void Query(double key_min, double key_max, double along_min, double along_max,
+                   std::vector<size_t>& candidates) const;
+    };
+
+    void Index();
+
+    double max_item_width_ = 0.0;
+    ItemBatch items_;
+    Lines rows_;
+    Lines columns_;
+};
+
+enum class GatherIndex {
+    GRID,
+    AXIS_SWEEP
+};
+
+struct ParallelGatherConfig {
+    // При меньшем числе собирателей поиск выполняется в вызывающем потоке
+    size_t min_gatherers = 1024;
+    // Число собирателей в одной порции работы
+    size_t gatherers_per_chunk = 256;
+    // Число задач, отправляемых в пул помимо вызывающего потока
+    size_t max_helpers = 3;
+    GatherIndex index = GatherIndex::GRID;
+    double cell_size = DEFAULT_GRID_CELL_SIZE;
+};
+
+/*
+ * Буферы поиска событий сбора, переиспользуемые между вызовами: индексы, кандидаты
+ * и список событий. Ёмкость буферов только растёт, поэтому после нескольких вызовов
+ * с похожим числом предметов и собирателей последовательный поиск не выделяет память.
+ */
+struct GatherWorkspace {
+    GatherWorkspace() = default;
+    explicit GatherWorkspace(double cell_size)
+        : grid{cell_size} {
+    }
+
+    ItemGrid grid;
+    AxisSweepIndex sweep;
+    std::vector<size_t> candidates;
+    std::vector<GatheringEvent> events;
+    // События порций параллельного поиска
+    std::vector<std::vector<GatheringEvent>> chunk_events;
+    std::vector<size_t> chunk_bounds;
+    // Кандидаты каждого потока параллельного поиска, нулевой - вызывающего
+    std::vector<std::vector<size_t>> worker_candidates;
+};
+
+namespace detail {
+
+inline bool IsMoving(const Gatherer& gatherer) {
+    return gatherer.end_pos.x != gatherer.start_pos.x || gatherer.end_pos.y != gatherer.start_pos.y;
+}
+
+void SortByTime(std::vector<GatheringEvent>& events);
+
+// Дописывают в events события сбора предметов индекса собирателем с индексом gatherer_id
+void CollectFromIndex(const ItemGrid& grid, const Gatherer& gatherer, size_t gatherer_id,
+                      std::vector<size_t>& candidates, std::vector<GatheringEvent>& events);
+// Собиратели, не параллельные осям, проверяются полным перебором
+void CollectFromIndex(const AxisSweepIndex& index, const Gatherer& gatherer, size_t gatherer_id,
+                      std::vector<size_t>& candidates, std::vector<GatheringEvent>& events);
+
+// Сливает упорядоченные по времени соседние диапазоны events, заданные границами bounds,
+// сохраняя порядок диапазонов при равном времени
+void MergeSortedRuns(std::vector<GatheringEvent>& events, const std::vector<size_t>& bounds);
+
+// Заполняет workspace.events событиями сбора, упорядоченными по времени
+template <typename Index, GathererProvider Provider>
+void CollectSerial(const Index& index, const Provider& provider, GatherWorkspace& workspace) {
+    auto& result = workspace.events;
+    result.clear();
+    const size_t gatherers_count = provider.GatherersCount();
+    for (size_t g = 0; g < gatherers_count; ++g) {
+        CollectFromIndex(index, provider.GetGatherer(g), g, workspace.candidates, result);
+    }
+    SortByTime(result);
+}
+
+template <typename Index, GathererProvider Provider, typename Post>
+void CollectParallel(const Index& index, const Provider& provider, Post& post,
+                     const ParallelGatherConfig& config, GatherWorkspace& workspace) {
+    const size_t gatherers_count = provider.GatherersCount();
+    const size_t chunk_size = std::max<size_t>(config.gatherers_per_chunk, 1);
+    const size_t chunks_count = (gatherers_count + chunk_size - 1) / chunk_size;
+
+    auto& chunk_events = workspace.chunk_events;
+    if (chunk_events.size() < chunks_count) {
+        chunk_events.resize(chunks_count);
+    }
+    for (size_t chunk = 0; chunk < chunks_count; ++chunk) {
+        chunk_events[chunk].clear();
+    }
+
+    struct Shared {
+        explicit Shared(size_t chunks)
+            : done(static_cast<std::ptrdiff_t>(chunks)) {
+        }
+        std::atomic<size_t> next_chunk{0};
+        std::latch done;
+    };
+    auto shared = std::make_shared<Shared>(chunks_count);
+
+    // При пустом списке собирателей порций нет и помощники не нужны
+    const size_t helpers = chunks_count > 1 ? std::min(config.max_helpers, chunks_count - 1) : 0;
+    auto& worker_candidates = workspace.worker_candidates;
+    if (worker_candidates.size() < helpers + 1) {
+        worker_candidates.resize(helpers + 1);
+    }
+
+    // Захватывает порции, пока они есть. Обращается к провайдеру, индексу и буферам
+    // только после успешного захвата порции, то есть пока вызывающий поток ждёт завершения
+    auto work = [shared, &provider, &index, &chunk_events, &worker_candidates, chunk_size, chunks_count,
+                 gatherers_count](size_t worker) {
+        for (size_t chunk = shared->next_chunk++; chunk < chunks_count; chunk = shared->next_chunk++) {
+            auto& candidates = worker_candidates[worker];
+            auto& events = chunk_events[chunk];
+            const size_t last = std::min(gatherers_count, (chunk + 1) * chunk_size);
+            for (size_t g = chunk * chunk_size; g < last; ++g) {
+                CollectFromIndex(index, provider.GetGatherer(g), g, candidates, events);
+            }
+            SortByTime(events);
+            shared->done.count_down();
+        }
+    };
+
+    for (size_t h = 0; h < helpers; ++h) {
+        post(std::function<void()>{[work, h] {
+            work(h + 1);
+        }});
+    }
+    work(0);
+    shared->done.wait();
+
+    auto& result = workspace.events;
+    auto& bounds = workspace.chunk_bounds;
+    result.clear();
+    bounds.assign(1, 0);
+    for (size_t chunk = 0; chunk < chunks_count; ++chunk) {
+        result.insert(result.end(), chunk_events[chunk].begin(), chunk_events[chunk].end());
+        bounds.push_back(result.size());
+    }
+    MergeSortedRuns(result, bounds);
+}
+
+}  // namespace detail
+
+// События упорядочены по времени, при равном времени - по (gatherer_id, item_id).
+template <GathererProvider Provider>
+std::vector<GatheringEvent> FindGatherEvents(const Provider& provider) {
+    std::vector<GatheringEvent> result;
+    ItemBatch items;
+    items.Load(provider);
+    const size_t gatherers_count = provider.GatherersCount();
+    for (size_t g = 0; g < gatherers_count; ++g) {
+        const Gatherer gatherer = provider.GetGatherer(g);
+        if (!detail::IsMoving(gatherer)) {
+            continue;
+        }
+        CollectBatch(items, gatherer, g, result);
+    }
+    detail::SortByTime(result);
+    return result;
+}
+
+// То же, что FindGatherEvents, но перебирает только предметы из ячеек сетки рядом с собирателем.
+// Возвращает в точности тот же список событий.
+template <GathererProvider Provider>
+std::vector<GatheringEvent> FindGatherEventsGrid(const Provider& provider, double cell_size = DEFAULT_GRID_CELL_SIZE) {
+    GatherWorkspace workspace{cell_size};
+    workspace.grid.Build(provider);
+    detail::CollectSerial(workspace.grid, provider, workspace);
+    return std::move(workspace.events);
+}
+
+// То же, что FindGatherEvents, но для собирателей, параллельных осям, перебирает только
+// предметы из соседних рядов (столбцов) AxisSweepIndex. Возвращает в точности тот же список событий.
+template <GathererProvider Provider>
+std::vector<GatheringEvent> FindGatherEventsSweep(const Provider& provider) {
+    GatherWorkspace workspace;
+    workspace.sweep.Build(provider);
+    detail::CollectSerial(workspace.sweep, provider, workspace);
+    return std::move(workspace.events);
+}
+
+/*
+ * Параллельный вариант FindGatherEventsGrid (FindGatherEventsSweep при config.index == AXIS_SWEEP).
+ * Собиратели делятся на порции, порции разбирают вызывающий поток и задачи, отправленные
+ * через post(std::function<void()>) в пул потоков. Результат побитово совпадает с последовательным вариантом.
+ * Вызывающий поток сам обрабатывает оставшиеся порции, поэтому занятый пул не приводит
+ * к взаимоблокировке, а задачи, запущенные после возврата из функции, ничего не делают.
+ * Результат лежит в workspace.events и действителен до следующего вызова с тем же workspace.
+ */
+template <GathererProvider Provider, typename Post>
+const std::vector<GatheringEvent>& FindGatherEventsParallel(const Provider& provider, Post&& post,
+                                                            GatherWorkspace& workspace,
+                                                            const ParallelGatherConfig& config = {}) {
+    const bool serial = provider.GatherersCount() < config.min_gatherers || config.max_helpers == 0;
+    auto collect = [&](auto& index) {
+        index.Build(provider);
+        if (serial) {
+            detail::CollectSerial(index, provider, workspace);
+        } else {
+            detail::CollectParallel(index, provider, post, config, workspace);
+        }
+    };
+    if (config.index == GatherIndex::AXIS_SWEEP) {
+        collect(workspace.sweep);
+    } else {
+        if (workspace.grid.GetCellSize() != config.cell_size) {
+            workspace.grid = ItemGrid{config.cell_size};
+        }
+        collect(workspace.grid);
+    }
+    return workspace.events;
+}
+
+// То же с одноразовыми буферами
+template <GathererProvider Provider, typename Post>
+std::vector<GatheringEvent> FindGatherEventsParallel(const Provider& provider, Post&& post,
+                                                     const ParallelGatherConfig& config = {}) {
+    GatherWorkspace workspace;
+    FindGatherEventsParallel(provider, post, workspace, config);
+    return std::move(workspace.events);
+}
+
+// Варианты для провайдеров с виртуальным интерфейсом. Оставлены для существующего кода,
+// новым провайдерам лучше передаваться в шаблонные функции по своему типу.
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
+std::vector<GatheringEvent> FindGatherEventsGrid(const ItemGathererProvider& provider, double cell_size);
 
 }  // namespace collision_detector
\ No newline at end of file
@@ -1,25 +1,20 @@
 #include "item_dog_provider.h"
 
-namespace model {
-
-size_t ItemDogProvider::ItemsCount() const {
-    return items_.size();
-};
+#include <cassert>
 
-collision_detector::Item ItemDogProvider::GetItem(size_t idx) const {
-    return *items_[idx];
-};
+namespace model {
 
-size_t ItemDogProvider::GatherersCount() const {
-    return dogs_.size();
-};
+Dog& ItemDogProvider::GetDog(size_t idx) const noexcept {
+    return dogs_.GetOwner(idx);
+}
 
-collision_detector::Gatherer ItemDogProvider::GetGatherer(size_t idx) const {
-    return dogs_[idx]->GetGatherer();
-};
+ItemDogProvider::ItemKind ItemDogProvider::GetItemKind(size_t idx) const noexcept {
+    return idx < lost_objects_.size() ? ItemKind::LOST_OBJECT : ItemKind::OFFICE;
+}
 
-const Dog::Id& ItemDogProvider::GetDogId(size_t idx) const {
-    return dogs_[idx]->GetId();
-};
+const LostObject& ItemDogProvider::GetLostObject(size_t idx) const {
+    assert(GetItemKind(idx) == ItemKind::LOST_OBJECT);
+    return lost_objects_[idx];
+}
 
-}  // namespace model
\ No newline at end of file
+}  // namespace model
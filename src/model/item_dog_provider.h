@@ -1,36 +1,61 @@
 #pragma once
 #include <memory>
-#include <unordered_map>
+#include <span>
 
 #include "collision_detector.h"
 #include "model.h"
 
 namespace model {
 
-class ItemDogProvider : public collision_detector::ItemGathererProvider {
+/*
+ * Предметы провайдера: сначала потерянные предметы, затем офисы карты.
+ * Собиратели - первые gatherers_count псов в порядке слотов DogStates.
+ * Провайдер не владеет данными - все контейнеры должны жить дольше него.
+ */
+class ItemDogProvider final : public collision_detector::ItemGathererProvider {
    public:
-    using Items = std::vector<std::shared_ptr<collision_detector::Item> >;
-    using Dogs = std::vector<std::shared_ptr<Dog> >;
+    using LostObjects = std::span<const LostObject>;
 
-    ItemDogProvider(Items&& items, Dogs&& dogs)
-        : items_(std::move(items)), dogs_(std::move(dogs)){};
+    enum class ItemKind {
+        LOST_OBJECT,
+        OFFICE
+    };
+
+    ItemDogProvider(LostObjects lost_objects, const collision_detector::ItemBatch& offices, const DogStates& dogs,
+                    size_t gatherers_count)
+        : lost_objects_(lost_objects), offices_(offices), dogs_(dogs), gatherers_count_(gatherers_count){};
     virtual ~ItemDogProvider() = default;
 
-    size_t ItemsCount() const override;
-    collision_detector::Item GetItem(size_t idx) const override;
-    size_t GatherersCount() const override;
-    collision_detector::Gatherer GetGatherer(size_t idx) const override;
+    // Методы определены в заголовке, чтобы шаблонный FindGatherEvents мог их встроить
+    size_t ItemsCount() const override {
+        return lost_objects_.size() + offices_.Size();
+    }
 
-    const Dog::Id& GetDogId(size_t idx) const;
+    collision_detector::Item GetItem(size_t idx) const override {
+        if (idx < lost_objects_.size()) {
+            return {lost_objects_[idx].GetPosition(), lost_objects_[idx].GetWidth()};
+        }
+        idx -= lost_objects_.size();
+        return {{offices_.xs[idx], offices_.ys[idx]}, offices_.widths[idx]};
+    }
 
-    template <typename T>
-    const T* const TryCastItemTo(size_t idx) const {
-        return dynamic_cast<T*>(items_[idx].get());
-    };
+    size_t GatherersCount() const override {
+        return gatherers_count_;
+    }
+
+    collision_detector::Gatherer GetGatherer(size_t idx) const override {
+        return dogs_.GetGatherer(idx);
+    }
+
+    Dog& GetDog(size_t idx) const noexcept;
+    ItemKind GetItemKind(size_t idx) const noexcept;
+    const LostObject& GetLostObject(size_t idx) const;
 
    private:
-    Items items_;
-    Dogs dogs_;
+    LostObjects lost_objects_;
+    const collision_detector::ItemBatch& offices_;
+    const DogStates& dogs_;
+    size_t gatherers_count_;
 };
 
-}  // namespace model
\ No newline at end of file
+}  // namespace model
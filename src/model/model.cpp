@@ -1,11 +1,11 @@
 #include "model.h"
 
 #include <boost/range/algorithm/sort.hpp>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <stdexcept>
-
-#include "item_dog_provider.h"
+#include <tuple>
 
 namespace model {
 using namespace std::literals;
@@ -110,35 +110,491 @@ const uint64_t& Map::GetBagCapacity() const noexcept {
     return bag_capacity_;
 }
 
+size_t Map::GetMaxPlayersPerSession() const noexcept {
+    return max_players_per_session_;
+}
+
+void Map::SetMaxPlayersPerSession(size_t max_players) {
+    if (max_players == 0) {
+        throw std::invalid_argument("Max players per session must be positive");
+    }
+    max_players_per_session_ = max_players;
+}
+
+const collision_detector::ItemBatch& Map::GetOfficeItems() const noexcept {
+    return office_items_;
+}
+
+const std::shared_ptr<const RoadIndex>& Map::GetRoadIndex() const noexcept {
+    return road_index_;
+}
+
+void Map::BuildRoadIndex() {
+    road_index_ = std::make_shared<const RoadIndex>(roads_);
+}
+
 void Map::AddRoad(const Road& road) {
     roads_.emplace_back(road);
+    // Индекс по неполному набору дорог больше не действителен
+    road_index_.reset();
 }
 
 void Map::AddBuilding(const Building& building) {
     buildings_.emplace_back(building);
 }
 
+namespace {
+
+// Общий пустой рюкзак: пустые рюкзаки всех псов не занимают памяти. На него всегда
+// ссылается и эта переменная, поэтому на месте он не меняется
+const std::shared_ptr<Dog::Bag>& EmptyBag() {
+    static const auto empty_bag = std::make_shared<Dog::Bag>();
+    return empty_bag;
+}
+
+// На рюкзак ссылается только пёс. Снимки, которые его держали, уже отпущены
+bool IsOwnBag(const std::shared_ptr<Dog::Bag>& bag) noexcept {
+    if (bag.use_count() != 1) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+// Смещение носа пса относительно его позиции
+geom::Vec2D NoseOffset(Direction direction) noexcept {
+    switch (direction) {
+        case Direction::NORTH:
+            return {0.0, -DEFAULT_DOG_HEIGHT};
+        case Direction::EAST:
+            return {DEFAULT_DOG_HEIGHT, 0.0};
+        case Direction::WEST:
+            return {-DEFAULT_DOG_HEIGHT, 0.0};
+        case Direction::SOUTH:
+            return {0.0, DEFAULT_DOG_HEIGHT};
+    }
+    return {};
+}
+
+}  // namespace
+
+DogStates::~DogStates() {
+    while (!owners_.empty()) {
+        Detach(*owners_.back());
+    }
+}
+
+template <typename Fn>
+void DogStates::ForEachColumn(Fn&& fn) {
+    fn(owners_);
+    fn(xs_);
+    fn(ys_);
+    fn(speed_xs_);
+    fn(speed_ys_);
+    fn(directions_);
+    fn(gatherer_start_xs_);
+    fn(gatherer_start_ys_);
+    fn(gatherer_end_xs_);
+    fn(gatherer_end_ys_);
+    fn(joined_ats_);
+    fn(idle_sinces_);
+    fn(actives_);
+    fn(retirement_positions_);
+}
+
+void DogStates::Attach(Dog& dog) {
+    assert(dog.states_ == nullptr);
+    const Dog::State& state = dog.state_;
+    owners_.push_back(&dog);
+    xs_.push_back(state.position.x);
+    ys_.push_back(state.position.y);
+    speed_xs_.push_back(state.speed.x);
+    speed_ys_.push_back(state.speed.y);
+    directions_.push_back(state.direction);
+    gatherer_start_xs_.push_back(state.gatherer.start_pos.x);
+    gatherer_start_ys_.push_back(state.gatherer.start_pos.y);
+    gatherer_end_xs_.push_back(state.gatherer.end_pos.x);
+    gatherer_end_ys_.push_back(state.gatherer.end_pos.y);
+    joined_ats_.push_back(now_ - state.live_time.count());
+    idle_sinces_.push_back(now_ - state.inactive_time.count());
+    actives_.push_back(state.is_active);
+    retirement_positions_.push_back(NOT_SCHEDULED);
+    dog.states_ = this;
+    dog.slot_ = owners_.size() - 1;
+    // В куче не больше одной записи на пса, поэтому тик не расширяет её
+    retirements_.reserve(owners_.size());
+    Schedule(dog.slot_);
+    // Новый пёс проходит хотя бы один тик среди движущихся
+    Touch(dog.slot_);
+}
+
+void DogStates::Detach(Dog& dog) {
+    assert(dog.states_ == this);
+    const Dog::State state = dog.GetState();
+    size_t slot = dog.slot_;
+    if (retirement_positions_[slot] != NOT_SCHEDULED) {
+        RemoveRetirement(retirement_positions_[slot]);
+    }
+    if (slot < moving_count_) {
+        --moving_count_;
+        Swap(slot, moving_count_);
+        slot = moving_count_;
+    }
+    const size_t last = owners_.size() - 1;
+    ForEachColumn([slot, last](auto& column) {
+        column[slot] = column[last];
+        column.pop_back();
+    });
+    if (slot != last) {
+        owners_[slot]->slot_ = slot;
+    }
+    changed_count_ = std::min(changed_count_, owners_.size());
+    dog.states_ = nullptr;
+    dog.state_ = state;
+}
+
+size_t DogStates::Size() const noexcept {
+    return owners_.size();
+}
+
+size_t DogStates::MovingCount() const noexcept {
+    return moving_count_;
+}
+
+size_t DogStates::ChangedGatherersCount() const noexcept {
+    return changed_count_;
+}
+
+Dog& DogStates::GetOwner(size_t slot) const noexcept {
+    return *owners_[slot];
+}
+
+collision_detector::Gatherer DogStates::GetGatherer(size_t slot) const noexcept {
+    return {{gatherer_start_xs_[slot], gatherer_start_ys_[slot]},
+            {gatherer_end_xs_[slot], gatherer_end_ys_[slot]},
+            DEFAULT_DOG_WIDTH};
+}
+
+void DogStates::Swap(size_t lhs, size_t rhs) {
+    if (lhs == rhs) {
+        return;
+    }
+    ForEachColumn([lhs, rhs](auto& column) {
+        std::swap(column[lhs], column[rhs]);
+    });
+    owners_[lhs]->slot_ = lhs;
+    owners_[rhs]->slot_ = rhs;
+}
+
+void DogStates::Touch(size_t slot) {
+    if (slot >= moving_count_) {
+        Swap(slot, moving_count_);
+        ++moving_count_;
+    }
+}
+
+void DogStates::PlaceRetirement(size_t position, const Retirement& retirement) noexcept {
+    retirements_[position] = retirement;
+    retirement_positions_[retirement.dog->slot_] = position;
+}
+
+void DogStates::SiftUp(size_t position) noexcept {
+    const Retirement retirement = retirements_[position];
+    while (position > 0) {
+        const size_t parent = (position - 1) / 2;
+        if (retirements_[parent].idle_since <= retirement.idle_since) {
+            break;
+        }
+        PlaceRetirement(position, retirements_[parent]);
+        position = parent;
+    }
+    PlaceRetirement(position, retirement);
+}
+
+void DogStates::SiftDown(size_t position) noexcept {
+    const Retirement retirement = retirements_[position];
+    const size_t size = retirements_.size();
+    for (size_t child = 2 * position + 1; child < size; child = 2 * position + 1) {
+        if (child + 1 < size && retirements_[child + 1].idle_since < retirements_[child].idle_since) {
+            ++child;
+        }
+        if (retirements_[child].idle_since >= retirement.idle_since) {
+            break;
+        }
+        PlaceRetirement(position, retirements_[child]);
+        position = child;
+    }
+    PlaceRetirement(position, retirement);
+}
+
+void DogStates::RemoveRetirement(size_t position) noexcept {
+    retirement_positions_[retirements_[position].dog->slot_] = NOT_SCHEDULED;
+    const Retirement last = retirements_.back();
+    retirements_.pop_back();
+    if (position == retirements_.size()) {
+        return;
+    }
+    PlaceRetirement(position, last);
+    SiftUp(position);
+    SiftDown(retirement_positions_[last.dog->slot_]);
+}
+
+void DogStates::Schedule(size_t slot) {
+    if (actives_[slot]) {
+        return;
+    }
+    const size_t position = retirement_positions_[slot];
+    if (position == NOT_SCHEDULED) {
+        retirements_.push_back({idle_sinces_[slot], owners_[slot]});
+        SiftUp(retirements_.size() - 1);
+        return;
+    }
+    // Запись с более поздним моментом остановки сработала бы слишком поздно.
+    // Момент остановки сдвигается назад только при явной установке состояния
+    if (retirements_[position].idle_since > idle_sinces_[slot]) {
+        retirements_[position].idle_since = idle_sinces_[slot];
+        SiftUp(position);
+    }
+}
+
+void DogStates::TakeRetired(std::vector<Dog*>& retired) {
+    const int64_t max_inactive_time =
+        std::chrono::duration_cast<std::chrono::milliseconds>(Dog::max_inactive_time_).count();
+    while (!retirements_.empty() && retirements_.front().idle_since + max_inactive_time <= now_) {
+        Dog* dog = retirements_.front().dog;
+        RemoveRetirement(0);
+        const size_t slot = dog->slot_;
+        if (actives_[slot]) {
+            // Пёс снова побежал. Когда он остановится, запись появится заново
+            continue;
+        }
+        if (idle_sinces_[slot] + max_inactive_time <= now_) {
+            retired.push_back(dog);
+        } else {
+            // Пёс двигался и снова остановился позже, чем указано в записи
+            Schedule(slot);
+        }
+    }
+}
+
+std::optional<std::chrono::milliseconds> DogStates::NextRetirementIn() const noexcept {
+    if (retirements_.empty()) {
+        return std::nullopt;
+    }
+    const int64_t max_inactive_time =
+        std::chrono::duration_cast<std::chrono::milliseconds>(Dog::max_inactive_time_).count();
+    return std::chrono::milliseconds{std::max<int64_t>(0, retirements_.front().idle_since + max_inactive_time - now_)};
+}
+
+int64_t DogStates::LiveTime(size_t slot) const noexcept {
+    return now_ - joined_ats_[slot];
+}
+
+int64_t DogStates::InactiveTime(size_t slot) const noexcept {
+    return actives_[slot] ? 0 : now_ - idle_sinces_[slot];
+}
+
+void DogStates::MoveAll(std::chrono::milliseconds delta, const RoadIndex& road_index) {
+    constexpr double HALF_ROAD_WIDTH = 0.8 / 2.0;
+
+    // Псы, стоявшие к началу тика, уходят из движущихся. Их собиратель - только нос,
+    // и дальше он не меняется, пока пса не сдвинут. Они встают сразу за движущимися
+    const size_t was_moving = moving_count_;
+    for (size_t i = moving_count_; i-- > 0;) {
+        if (speed_xs_[i] != 0.0 || speed_ys_[i] != 0.0) {
+            continue;
+        }
+        if (actives_[i]) {
+            actives_[i] = false;
+            idle_sinces_[i] = now_;
+            Schedule(i);
+        }
+        const geom::Vec2D nose = NoseOffset(directions_[i]);
+        gatherer_start_xs_[i] = xs_[i];
+        gatherer_start_ys_[i] = ys_[i];
+        gatherer_end_xs_[i] = xs_[i] + nose.x;
+        gatherer_end_ys_[i] = ys_[i] + nose.y;
+        --moving_count_;
+        Swap(i, moving_count_);
+    }
+    changed_count_ = was_moving;
+
+    const size_t count = moving_count_;
+    min_xs_.resize(count);
+    min_ys_.resize(count);
+    max_xs_.resize(count);
+    max_ys_.resize(count);
+
+    // Границы участка дорог, на котором находится пёс. Соседние отрезки одного ряда
+    // слиты в индексе, поэтому за тик любой длины пёс проходит перекрёстки по прямой одним поиском.
+    // Поиск в индексе не векторизуется, поэтому выполняется отдельным проходом
+    for (size_t i = 0; i < count; ++i) {
+        double min_x = xs_[i];
+        double min_y = ys_[i];
+        double max_x = xs_[i];
+        double max_y = ys_[i];
+        auto update_range = [&](Point start, Point end) {
+            min_x = std::min(start.x - HALF_ROAD_WIDTH, min_x);
+            min_y = std::min(start.y - HALF_ROAD_WIDTH, min_y);
+            max_x = std::max(end.x + HALF_ROAD_WIDTH, max_x);
+            max_y = std::max(end.y + HALF_ROAD_WIDTH, max_y);
+        };
+        const auto roads = road_index.GetRoadsAtPoint(
+            {static_cast<Coord>(std::round(xs_[i])), static_cast<Coord>(std::round(ys_[i]))});
+        if (roads.horizontal) {
+            update_range(roads.horizontal->GetStart(), roads.horizontal->GetEnd());
+        }
+        if (roads.vertical) {
+            update_range(roads.vertical->GetStart(), roads.vertical->GetEnd());
+        }
+        min_xs_[i] = min_x;
+        min_ys_[i] = min_y;
+        max_xs_[i] = max_x;
+        max_ys_[i] = max_y;
+    }
+
+    const double seconds = std::chrono::duration<double>(delta).count();
+    const double delta_ms = static_cast<double>(delta.count());
+    for (size_t i = 0; i < count; ++i) {
+        const double x = xs_[i];
+        const double y = ys_[i];
+        const double offset_x = speed_xs_[i] * seconds;
+        const double offset_y = speed_ys_[i] * seconds;
+        const double moved_x = x + offset_x;
+        const double moved_y = y + offset_y;
+        const double speed_x = IsValueInRange(moved_x, min_xs_[i], max_xs_[i]) ? speed_xs_[i] : 0.0;
+        const double speed_y = IsValueInRange(moved_y, min_ys_[i], max_ys_[i]) ? speed_ys_[i] : 0.0;
+        const double new_x = std::clamp(moved_x, min_xs_[i], max_xs_[i]);
+        const double new_y = std::clamp(moved_y, min_ys_[i], max_ys_[i]);
+
+        // Пёс движется вдоль одной оси. Если он упёрся в край дороги посреди тика,
+        // бездействие отсчитывается с момента остановки, а не с начала следующего тика
+        const double path = std::abs(offset_x) + std::abs(offset_y);
+        const double travelled = std::abs(new_x - x) + std::abs(new_y - y);
+        const int64_t moving_time =
+            path > 0.0 ? std::min(delta.count(), static_cast<int64_t>(std::nearbyint(delta_ms * (travelled / path))))
+                       : int64_t{0};
+
+        const bool active = speed_x != 0.0 || speed_y != 0.0;
+        xs_[i] = new_x;
+        ys_[i] = new_y;
+        speed_xs_[i] = speed_x;
+        speed_ys_[i] = speed_y;
+        // Остановившийся пёс остаётся среди движущихся до следующего тика
+        idle_sinces_[i] = (actives_[i] ? now_ : idle_sinces_[i]) + moving_time;
+        actives_[i] = active;
+        if (!active) {
+            Schedule(i);
+        }
+
+        // Собиратель покрывает весь путь за тик и нос впереди пса
+        const geom::Vec2D nose = NoseOffset(directions_[i]);
+        gatherer_start_xs_[i] = x;
+        gatherer_start_ys_[i] = y;
+        gatherer_end_xs_[i] = new_x + nose.x;
+        gatherer_end_ys_[i] = new_y + nose.y;
+    }
+    now_ += delta.count();
+}
+
 Dog::Dog(Id id, std::string name, geom::Point2D position, uint64_t bag_capacity)
-    : id_(std::move(id)), name_(std::move(name)), position_(std::move(position)), speed_(), gatherer_{{0.0, 0.0}, {0.0, 0.0}, DEFAULT_DOG_WIDTH}, bag_capacity_{bag_capacity}, score_{0}, inactive_time_{0}, live_time_{0} {
-    bag.reserve(bag_capacity_);
+    : id_(std::move(id)), name_(std::move(name)), bag_capacity_{bag_capacity}, bag_{EmptyBag()}, score_{0} {
+    state_.position = position;
+    state_.gatherer = {{0.0, 0.0}, {0.0, 0.0}, DEFAULT_DOG_WIDTH};
+}
+
+Dog::Dog(const Dog& other)
+    : id_(other.id_), name_(other.name_), owner_id_(other.owner_id_), state_(other.GetState()), bag_capacity_{other.bag_capacity_}, bag_(other.bag_), score_{other.score_} {
+}
+
+Dog& Dog::operator=(const Dog& other) {
+    if (this != &other) {
+        id_ = other.id_;
+        name_ = other.name_;
+        owner_id_ = other.owner_id_;
+        SetState(other.GetState());
+        bag_capacity_ = other.bag_capacity_;
+        bag_ = other.bag_;
+        score_ = other.score_;
+    }
+    return *this;
+}
+
+Dog::~Dog() {
+    if (states_) {
+        states_->Detach(*this);
+    }
+}
+
+Dog::State Dog::GetState() const noexcept {
+    if (!states_) {
+        return state_;
+    }
+    return {GetPosition(),
+            GetSpeed(),
+            GetDirection(),
+            GetGatherer(),
+            std::chrono::milliseconds{states_->InactiveTime(slot_)},
+            std::chrono::milliseconds{states_->LiveTime(slot_)},
+            static_cast<bool>(states_->actives_[slot_])};
+}
+
+void Dog::SetState(const State& state) noexcept {
+    if (!states_) {
+        state_ = state;
+        return;
+    }
+    states_->Touch(slot_);
+    SetPosition(state.position);
+    states_->speed_xs_[slot_] = state.speed.x;
+    states_->speed_ys_[slot_] = state.speed.y;
+    SetDirection(state.direction);
+    states_->gatherer_start_xs_[slot_] = state.gatherer.start_pos.x;
+    states_->gatherer_start_ys_[slot_] = state.gatherer.start_pos.y;
+    states_->gatherer_end_xs_[slot_] = state.gatherer.end_pos.x;
+    states_->gatherer_end_ys_[slot_] = state.gatherer.end_pos.y;
+    states_->idle_sinces_[slot_] = states_->now_ - state.inactive_time.count();
+    states_->joined_ats_[slot_] = states_->now_ - state.live_time.count();
+    states_->actives_[slot_] = state.is_active;
+    states_->Schedule(slot_);
 }
 
 const Dog::Id& Dog::GetId() const noexcept {
     return id_;
 }
+
+void Dog::SetId(Id id) noexcept {
+    id_ = std::move(id);
+}
+std::optional<uint32_t> Dog::GetOwnerId() const noexcept {
+    return owner_id_;
+}
+void Dog::SetOwnerId(uint32_t owner_id) noexcept {
+    owner_id_ = owner_id;
+}
 const std::string Dog::GetName() const noexcept {
     return name_;
 }
-const geom::Point2D& Dog::GetPosition() const noexcept {
-    return position_;
+geom::Point2D Dog::GetPosition() const noexcept {
+    if (states_) {
+        return {states_->xs_[slot_], states_->ys_[slot_]};
+    }
+    return state_.position;
 }
 
-const geom::Vec2D& Dog::GetSpeed() const noexcept {
-    return speed_;
+geom::Vec2D Dog::GetSpeed() const noexcept {
+    if (states_) {
+        return {states_->speed_xs_[slot_], states_->speed_ys_[slot_]};
+    }
+    return state_.speed;
 }
 
 const Dog::Bag& Dog::GetBag() const noexcept {
-    return bag;
+    return *bag_;
+}
+
+std::shared_ptr<const Dog::Bag> Dog::ShareBag() const noexcept {
+    return bag_;
 }
 
 const Score& Dog::GetScore() const noexcept {
@@ -146,42 +602,58 @@ const Score& Dog::GetScore() const noexcept {
 }
 
 void Dog::SetSpeed(geom::Vec2D speed) noexcept {
-    speed_ = speed;
-    if (speed_ != geom::Vec2D{0, 0}) {
-        is_active_ = true;
-        inactive_time_ = std::chrono::milliseconds{0};
-    } else {
-        is_active_ = false;
+    const bool active = speed != geom::Vec2D{0, 0};
+    if (states_) {
+        if (!active && states_->actives_[slot_]) {
+            states_->idle_sinces_[slot_] = states_->now_;
+        }
+        states_->Touch(slot_);
+        states_->speed_xs_[slot_] = speed.x;
+        states_->speed_ys_[slot_] = speed.y;
+        states_->actives_[slot_] = active;
+        states_->Schedule(slot_);
+        return;
+    }
+    state_.speed = speed;
+    state_.is_active = active;
+    if (active) {
+        state_.inactive_time = std::chrono::milliseconds{0};
     }
 }
 
 void Dog::SetPosition(geom::Point2D position) noexcept {
-    position_ = std::move(position);
+    if (states_) {
+        states_->Touch(slot_);
+        states_->xs_[slot_] = position.x;
+        states_->ys_[slot_] = position.y;
+        return;
+    }
+    state_.position = position;
 }
 
 void Dog::SetDirection(Direction direction) noexcept {
-    direction_ = direction;
-}
-
-void Dog::SetGatherer() noexcept {
-    switch (direction_) {
-        case Direction::NORTH:
-            gatherer_.start_pos = {position_.x, position_.y - DEFAULT_DOG_HEIGHT};
-            gatherer_.end_pos = position_;
-            break;
-        case Direction::EAST:
-            gatherer_.start_pos = {position_.x + DEFAULT_DOG_HEIGHT, position_.y};
-            gatherer_.end_pos = position_;
-            break;
-        case Direction::WEST:
-            gatherer_.start_pos = {position_.x - DEFAULT_DOG_HEIGHT, position_.y};
-            gatherer_.end_pos = position_;
-            break;
-        case Direction::SOUTH:
-            gatherer_.start_pos = {position_.x, position_.y + DEFAULT_DOG_HEIGHT};
-            gatherer_.end_pos = position_;
-            break;
+    if (states_) {
+        states_->Touch(slot_);
+        states_->directions_[slot_] = direction;
+        return;
+    }
+    state_.direction = direction;
+}
+
+void Dog::SetGatherer(geom::Point2D previous_position) noexcept {
+    // Собиратель покрывает весь путь за тик и нос длиной DEFAULT_DOG_HEIGHT впереди пса,
+    // поэтому подобранные предметы не зависят от длительности тика
+    const geom::Point2D end = GetPosition() + NoseOffset(GetDirection());
+    if (states_) {
+        states_->Touch(slot_);
+        states_->gatherer_start_xs_[slot_] = previous_position.x;
+        states_->gatherer_start_ys_[slot_] = previous_position.y;
+        states_->gatherer_end_xs_[slot_] = end.x;
+        states_->gatherer_end_ys_[slot_] = end.y;
+        return;
     }
+    state_.gatherer.start_pos = previous_position;
+    state_.gatherer.end_pos = end;
 }
 
 void Dog::SetScore(size_t score) noexcept {
@@ -189,11 +661,17 @@ void Dog::SetScore(size_t score) noexcept {
 }
 
 Direction Dog::GetDirection() const noexcept {
-    return direction_;
+    if (states_) {
+        return states_->directions_[slot_];
+    }
+    return state_.direction;
 }
 
-const collision_detector::Gatherer& Dog::GetGatherer() const {
-    return gatherer_;
+collision_detector::Gatherer Dog::GetGatherer() const {
+    if (states_) {
+        return states_->GetGatherer(slot_);
+    }
+    return state_.gatherer;
 };
 
 const size_t& Dog::GetBagCapacity() const noexcept {
@@ -201,39 +679,60 @@ const size_t& Dog::GetBagCapacity() const noexcept {
 }
 
 bool Dog::isFullBag() const noexcept {
-    return bag_capacity_ <= bag.size();
+    return bag_capacity_ <= bag_->size();
 }
 
 bool Dog::isEmptyBag() const noexcept {
-    return bag.empty();
+    return bag_->empty();
 }
 
 [[nodiscard]] bool Dog::AddItemToBag(FoundObject item) {
     if (isFullBag())
         return false;
-    bag.push_back(std::move(item));
+    if (!IsOwnBag(bag_)) {
+        // Старый рюкзак держат снимки, поэтому меняем копию
+        auto bag = std::make_shared<Bag>();
+        bag->reserve(bag_capacity_);
+        bag->assign(bag_->begin(), bag_->end());
+        bag_ = std::move(bag);
+    }
+    bag_->push_back(std::move(item));
     return true;
 }
 
 void Dog::ClearBag() {
-    for (int i = 0; i < bag.size(); i++)
-        score_ += bag[i].value;
-    bag.clear();
+    for (const auto& item : *bag_)
+        score_ += item.value;
+    if (IsOwnBag(bag_)) {
+        bag_->clear();
+    } else {
+        bag_ = EmptyBag();
+    }
 }
 
 std::optional<std::chrono::seconds> Dog::GetPlayTime() {
-    if (is_active_ || std::chrono::duration_cast<std::chrono::seconds>(inactive_time_) < max_inactive_time_) {
+    const State state = GetState();
+    if (state.is_active || std::chrono::duration_cast<std::chrono::seconds>(state.inactive_time) < max_inactive_time_) {
         return std::nullopt;
     }
-    return std::chrono::duration_cast<std::chrono::seconds>(live_time_);
+    return std::chrono::duration_cast<std::chrono::seconds>(state.live_time);
 };
 
 void Dog::UpdatePlayTime(const std::chrono::milliseconds& delta_time) {
-    live_time_ += delta_time;
+    if (states_) {
+        states_->joined_ats_[slot_] -= delta_time.count();
+        return;
+    }
+    state_.live_time += delta_time;
 }
 
 void Dog::UpdateInactiveTime(const std::chrono::milliseconds& delta_time) {
-    inactive_time_ += delta_time;
+    if (states_) {
+        states_->idle_sinces_[slot_] -= delta_time.count();
+        states_->Schedule(slot_);
+        return;
+    }
+    state_.inactive_time += delta_time;
 }
 
 void Dog::SetMaxInactiveTime(size_t max_inactive_time_in_seconds) {
@@ -241,11 +740,23 @@ void Dog::SetMaxInactiveTime(size_t max_inactive_time_in_seconds) {
 }
 
 void Dog::SetActive(bool active) {
-    is_active_ = active;
+    if (states_) {
+        if (!active && states_->actives_[slot_]) {
+            states_->idle_sinces_[slot_] = states_->now_;
+        }
+        states_->Touch(slot_);
+        states_->actives_[slot_] = active;
+        states_->Schedule(slot_);
+        return;
+    }
+    state_.is_active = active;
 }
 
 bool Dog::IsActive() noexcept {
-    return is_active_;
+    if (states_) {
+        return states_->actives_[slot_];
+    }
+    return state_.is_active;
 }
 
 void Map::AddOffice(Office office) {
@@ -262,78 +773,138 @@ void Map::AddOffice(Office office) {
         offices_.pop_back();
         throw;
     }
+    office_items_.Add(o.GetPosition(), o.GetWidth());
 }
 
 void Map::AddLootType(LootType loot_type) {
     loot_types_.emplace_back(loot_type);
 }
 
-RoadIndex::RoadIndex(const Map::Roads& roads) {
+namespace {
+
+// Число корзин рядов не больше чем в ROAD_BUCKETS_FACTOR раз превышает число дорог
+// (плюс запас для маленьких карт)
+constexpr size_t ROAD_BUCKETS_FACTOR = 4;
+constexpr size_t ROAD_BUCKETS_SLACK = 1024;
+
+// lower_bound без ветвлений: на коротких массивах не страдает от ошибок предсказания переходов
+template <typename T>
+const T* BranchlessLowerBound(const T* first, size_t count, T value) noexcept {
+    while (count > 1) {
+        const size_t half = count / 2;
+        first = first[half - 1] < value ? first + half : first;
+        count -= half;
+    }
+    return count == 1 && *first < value ? first + 1 : first;
+}
+
+}  // namespace
+
+RoadIndex::RoadIndex(const std::vector<Road>& roads)
+    : horizontal_roads_{CollectSegments(roads, true)}, vertical_roads_{CollectSegments(roads, false)} {
+}
+
+std::vector<RoadIndex::Lines::Segment> RoadIndex::CollectSegments(const std::vector<Road>& roads, bool horizontal) {
+    std::vector<Lines::Segment> segments;
     for (const Road& r : roads) {
+        if (r.IsHorizontal() != horizontal) {
+            continue;
+        }
         auto norm_road = r.Normalized();
-        if (r.IsHorizontal()) {
-            horizontal_roads_[r.GetStart().y].emplace_back(norm_road.GetStart().x,
-                                                           norm_road.GetEnd().x);
+        if (horizontal) {
+            segments.push_back({r.GetStart().y, norm_road.GetStart().x, norm_road.GetEnd().x});
         } else {
-            vertical_roads_[r.GetStart().x].emplace_back(norm_road.GetStart().y,
-                                                         norm_road.GetEnd().y);
+            segments.push_back({r.GetStart().x, norm_road.GetStart().y, norm_road.GetEnd().y});
         }
     }
-
-    MergeFragments(horizontal_roads_);
-    MergeFragments(vertical_roads_);
+    return segments;
 }
 
 RoadIndex::Roads RoadIndex::GetRoadsAtPoint(Point pt) const noexcept {
     Roads result;
+    if (const RoadFragment* fragment = horizontal_roads_.Find(pt.y, pt.x)) {
+        result.horizontal.emplace(Road::HORIZONTAL, Point{fragment->first, pt.y}, fragment->second);
+    }
+    if (const RoadFragment* fragment = vertical_roads_.Find(pt.x, pt.y)) {
+        result.vertical.emplace(Road::VERTICAL, Point{pt.x, fragment->first}, fragment->second);
+    }
+    return result;
+}
 
-    struct Comp {
-        bool operator()(Coord c, const RoadFragment& f) {
-            return c < f.first;
-        }
-        bool operator()(const RoadFragment& f, Coord c) {
-            return f.second < c;
-        }
-    };
-
-    if (auto it = horizontal_roads_.find(pt.y); it != horizontal_roads_.end()) {
-        const auto& fragments = it->second;
-        if (auto [l_bound, u_bound] = std::equal_range(fragments.begin(), fragments.end(), pt.x, Comp{});
-            l_bound != u_bound) {
-            assert(std::distance(l_bound, u_bound) == 1);
-            auto [x_start, x_end] = *l_bound;
-            result.horizontal.emplace(Road::HORIZONTAL, Point{x_start, pt.y}, x_end);
+RoadIndex::Lines::Lines(std::vector<Segment> segments) {
+    const size_t segments_count = segments.size();
+    boost::range::sort(segments, [](const Segment& lhs, const Segment& rhs) {
+        return std::tie(lhs.key, lhs.start) < std::tie(rhs.key, rhs.start);
+    });
+
+    // Сливаем перекрывающиеся и соприкасающиеся отрезки одного ряда
+    for (const Segment& s : segments) {
+        if (keys_.empty() || keys_.back() != s.key) {
+            keys_.push_back(s.key);
+            starts_.push_back(static_cast<uint32_t>(fragments_.size()));
+            fragments_.emplace_back(s.start, s.end);
+        } else if (s.start > fragments_.back().second) {
+            fragments_.emplace_back(s.start, s.end);
+        } else {
+            fragments_.back().second = std::max(fragments_.back().second, s.end);
         }
     }
+    starts_.push_back(static_cast<uint32_t>(fragments_.size()));
+    keys_.shrink_to_fit();
+    fragments_.shrink_to_fit();
 
-    if (auto it = vertical_roads_.find(pt.x); it != vertical_roads_.end()) {
-        if (auto [l_bound, u_bound] = std::equal_range(it->second.begin(), it->second.end(), pt.y, Comp{});
-            l_bound != u_bound) {
-            assert(std::distance(l_bound, u_bound) == 1);
-            auto [y_start, y_end] = *l_bound;
-            result.vertical.emplace(Road::VERTICAL, Point{pt.x, y_start}, y_end);
+    if (keys_.empty()) {
+        buckets_.assign(1, 0);
+        return;
+    }
+    min_key_ = keys_.front();
+    const uint64_t max_offset = static_cast<uint64_t>(static_cast<int64_t>(keys_.back()) - min_key_);
+    const uint64_t max_buckets = ROAD_BUCKETS_FACTOR * segments_count + ROAD_BUCKETS_SLACK;
+    while ((max_offset >> bucket_shift_) + 1 > max_buckets) {
+        ++bucket_shift_;
+    }
+
+    // У корзин без рядов пустой диапазон
+    const size_t buckets_count = static_cast<size_t>(max_offset >> bucket_shift_) + 1;
+    buckets_.resize(buckets_count + 1);
+    size_t line = 0;
+    for (size_t bucket = 0; bucket <= buckets_count; ++bucket) {
+        while (line < keys_.size() && BucketOf(keys_[line]) < bucket) {
+            ++line;
         }
+        buckets_[bucket] = static_cast<uint32_t>(line);
     }
+}
 
-    return result;
+size_t RoadIndex::Lines::BucketOf(Coord key) const noexcept {
+    return static_cast<size_t>(static_cast<uint64_t>(static_cast<int64_t>(key) - min_key_) >> bucket_shift_);
 }
 
-void RoadIndex::MergeFragments(RoadFragmentsMap& fragments_map) {
-    for (auto& [_, fragments] : fragments_map) {
-        boost::range::sort(fragments, [](const RoadFragment& lhs, const RoadFragment& rhs) {
-            return lhs.first < rhs.first;
-        });
-        RoadFragment* fragment = fragments.data();
-        for (RoadFragment& f : fragments) {
-            if (f.first > fragment->second) {
-                ++fragment;
-                *fragment = f;
-            } else {
-                fragment->second = std::max(fragment->second, f.second);
-            }
-        }
-        fragments.resize(fragment - fragments.data() + 1);
+const RoadIndex::RoadFragment* RoadIndex::Lines::Find(Coord key, Coord along) const noexcept {
+    if (key < min_key_) {
+        return nullptr;
+    }
+    const size_t bucket = BucketOf(key);
+    if (bucket + 1 >= buckets_.size()) {
+        return nullptr;
+    }
+    const Coord* first_key = keys_.data() + buckets_[bucket];
+    const Coord* last_key = keys_.data() + buckets_[bucket + 1];
+    const Coord* line_key = BranchlessLowerBound(first_key, last_key - first_key, key);
+    if (line_key == last_key || *line_key != key) {
+        return nullptr;
+    }
+    const size_t line = line_key - keys_.data();
+
+    const auto first = fragments_.begin() + starts_[line];
+    const auto last = fragments_.begin() + starts_[line + 1];
+    auto it = std::upper_bound(first, last, along, [](Coord c, const RoadFragment& f) {
+        return c < f.first;
+    });
+    if (it == first || std::prev(it)->second < along) {
+        return nullptr;
     }
+    return &*std::prev(it);
 }
 
 bool IsValueInRange(double value, double min_value, double max_value) {
@@ -362,6 +933,7 @@ void Game::AddMap(Map map) {
         throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
     } else {
         try {
+            map.BuildRoadIndex();
             auto map_ptr = std::make_shared<Map>(std::move(map));
             maps_.emplace_back(std::move(map_ptr));
         } catch (...) {
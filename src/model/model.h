@@ -1,6 +1,8 @@
 #pragma once
 #include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <unordered_map>
@@ -60,6 +62,63 @@ class Road {
     Point end_;
 };
 
+/*
+ * Индекс дорог для быстрого поиска дорог, проходящих через точку.
+ * Слитые отрезки дорог всех рядов (столбцов) лежат в одном непрерывном буфере,
+ * сгруппированными по координате ряда и упорядоченными внутри ряда.
+ * Ряд находится по смещению его координаты в плотном массиве корзин. На разреженных картах
+ * корзина охватывает несколько соседних координат, и ряд ищется среди отсортированных координат корзины.
+ */
+class RoadIndex {
+   public:
+    struct Roads {
+        std::optional<Road> horizontal;
+        std::optional<Road> vertical;
+    };
+
+    explicit RoadIndex(const std::vector<Road>& roads);
+
+    Roads GetRoadsAtPoint(Point pt) const noexcept;
+
+   private:
+    using RoadFragment = std::pair<Coord, Coord>;
+
+    // Отрезки дорог одной ориентации. key - координата ряда, along - координата вдоль ряда
+    class Lines {
+       public:
+        struct Segment {
+            Coord key;
+            Coord start;
+            Coord end;
+        };
+
+        explicit Lines(std::vector<Segment> segments);
+
+        // Возвращает слитый отрезок ряда key, содержащий точку along
+        const RoadFragment* Find(Coord key, Coord along) const noexcept;
+
+       private:
+        size_t BucketOf(Coord key) const noexcept;
+
+        Coord min_key_ = 0;
+        // Корзина ряда - (key - min_key_) >> bucket_shift_. На плотных картах сдвиг нулевой
+        // и в каждой корзине не больше одного ряда
+        unsigned bucket_shift_ = 0;
+        // buckets_[b]..buckets_[b + 1] - диапазон рядов корзины b в keys_
+        std::vector<uint32_t> buckets_;
+        // Отсортированные координаты рядов
+        std::vector<Coord> keys_;
+        // starts_[l]..starts_[l + 1] - диапазон ряда l в fragments_
+        std::vector<uint32_t> starts_;
+        std::vector<RoadFragment> fragments_;
+    };
+
+    static std::vector<Lines::Segment> CollectSegments(const std::vector<Road>& roads, bool horizontal);
+
+    Lines horizontal_roads_;
+    Lines vertical_roads_;
+};
+
 class Building {
    public:
     explicit Building(Rectangle bounds) noexcept;
@@ -112,6 +171,13 @@ class Map {
     const int64_t& GetLootTypeValue(uint64_t index) const noexcept;
 
     const uint64_t& GetBagCapacity() const noexcept;
+    // Сколько игроков помещается в одну сессию на карте. Остальные попадают в новые сессии
+    size_t GetMaxPlayersPerSession() const noexcept;
+    void SetMaxPlayersPerSession(size_t max_players);
+    const collision_detector::ItemBatch& GetOfficeItems() const noexcept;
+    // Индекс строится один раз после загрузки всех дорог карты
+    const std::shared_ptr<const RoadIndex>& GetRoadIndex() const noexcept;
+    void BuildRoadIndex();
     void AddRoad(const Road& road);
     void AddBuilding(const Building& building);
     void AddOffice(Office office);
@@ -125,9 +191,15 @@ class Map {
     Roads roads_;
     Buildings buildings_;
     Offices offices_;
+    // Офисы в виде, пригодном для поиска столкновений. Строится при загрузке карты
+    // и используется всеми сессиями на этой карте
+    collision_detector::ItemBatch office_items_;
+    // Общий для всех сессий на этой карте
+    std::shared_ptr<const RoadIndex> road_index_;
     OfficeIdToIndex warehouse_id_to_index_;
     double dog_speed_;
     uint64_t bag_capacity_;
+    size_t max_players_per_session_ = DEFAULT_MAX_PLAYERS_PER_SESSION;
     LootTypes loot_types_;
 };
 
@@ -152,6 +224,107 @@ struct FoundObject {
     [[nodiscard]] auto operator<=>(const FoundObject&) const = default;
 };
 
+class Dog;
+
+/*
+ * Изменяемое на каждом тике состояние псов сессии в виде структуры массивов:
+ * позиции, скорости, направления, собиратели и счётчики времени лежат в отдельных
+ * непрерывных массивах, индексируемых номером слота. Пёс, привязанный к хранилищу,
+ * читает и меняет своё состояние через слот. При удалении на место освободившегося
+ * слота переносится последний, а его владельцу сообщается новый номер.
+ *
+ * Движущиеся псы занимают первые слоты, и MoveAll обрабатывает только их. Стоящие псы
+ * не меняются от тика к тику: время игры и бездействия считается от времени сессии
+ * по моментам входа в игру и остановки. Любое изменение пса возвращает его к движущимся.
+ */
+class DogStates {
+   public:
+    DogStates() = default;
+    DogStates(const DogStates&) = delete;
+    DogStates& operator=(const DogStates&) = delete;
+    // Возвращает состояние всем оставшимся псам
+    ~DogStates();
+
+    // Переносит состояние пса в хранилище
+    void Attach(Dog& dog);
+    // Возвращает состояние псу и освобождает его слот
+    void Detach(Dog& dog);
+
+    size_t Size() const noexcept;
+    size_t MovingCount() const noexcept;
+    // Собиратели в слотах [0, ChangedGatherersCount()) могли измениться на последнем MoveAll:
+    // это движущиеся псы и псы, остановившиеся к началу тика. Собиратели остальных
+    // псов - неподвижный нос, такой же, как на прошлом тике
+    size_t ChangedGatherersCount() const noexcept;
+    Dog& GetOwner(size_t slot) const noexcept;
+    collision_detector::Gatherer GetGatherer(size_t slot) const noexcept;
+
+    // Перемещает движущихся псов вдоль дорог за время delta и обновляет их собиратели.
+    // Время сессии увеличивается на delta
+    void MoveAll(std::chrono::milliseconds delta, const RoadIndex& road_index);
+    // Дописывает в retired псов, простоявших не меньше Dog::max_inactive_time_, и забывает о них.
+    // Моменты остановки хранятся в куче, поэтому вызов стоит O(log N) на каждую истёкшую запись
+    void TakeRetired(std::vector<Dog*>& retired);
+    // Через сколько истечёт ближайшая запись кучи ухода псов. Запись может оказаться
+    // устаревшей, поэтому срок - не позже которого стоит вызвать TakeRetired
+    std::optional<std::chrono::milliseconds> NextRetirementIn() const noexcept;
+
+   private:
+    friend class Dog;
+
+    template <typename Fn>
+    void ForEachColumn(Fn&& fn);
+    void Swap(size_t lhs, size_t rhs);
+    // Переносит пса к движущимся
+    void Touch(size_t slot);
+    int64_t LiveTime(size_t slot) const noexcept;
+    int64_t InactiveTime(size_t slot) const noexcept;
+
+    // Запись кучи ухода псов. Не больше одной записи на пса: если пёс с тех пор двигался,
+    // запись устарела и при извлечении отбрасывается или переносится на новый момент остановки
+    struct Retirement {
+        int64_t idle_since;
+        Dog* dog;
+    };
+    static constexpr size_t NOT_SCHEDULED = std::numeric_limits<size_t>::max();
+    // Заводит запись для стоящего пса, если её ещё нет, или сдвигает её на более ранний момент
+    void Schedule(size_t slot);
+    // Куча с ранней записью в корне. Каждый пёс знает позицию своей записи,
+    // поэтому перенос и удаление записи стоят O(log N)
+    void PlaceRetirement(size_t position, const Retirement& retirement) noexcept;
+    void SiftUp(size_t position) noexcept;
+    void SiftDown(size_t position) noexcept;
+    void RemoveRetirement(size_t position) noexcept;
+
+    // Время сессии в миллисекундах - сумма delta всех вызовов MoveAll
+    int64_t now_ = 0;
+    size_t moving_count_ = 0;
+    size_t changed_count_ = 0;
+
+    std::vector<Dog*> owners_;
+    std::vector<double> xs_;
+    std::vector<double> ys_;
+    std::vector<double> speed_xs_;
+    std::vector<double> speed_ys_;
+    std::vector<Direction> directions_;
+    std::vector<double> gatherer_start_xs_;
+    std::vector<double> gatherer_start_ys_;
+    std::vector<double> gatherer_end_xs_;
+    std::vector<double> gatherer_end_ys_;
+    // Моменты времени сессии, когда пёс вошёл в игру и когда остановился
+    std::vector<int64_t> joined_ats_;
+    std::vector<int64_t> idle_sinces_;
+    std::vector<uint8_t> actives_;
+    // Позиция записи пса в retirements_ или NOT_SCHEDULED
+    std::vector<size_t> retirement_positions_;
+    std::vector<Retirement> retirements_;
+    // Границы участка дорог, доступного каждому псу на текущем тике, переиспользуются между тиками
+    std::vector<double> min_xs_;
+    std::vector<double> min_ys_;
+    std::vector<double> max_xs_;
+    std::vector<double> max_ys_;
+};
+
 class Dog {
     inline static std::chrono::seconds max_inactive_time_{ONE_MINUTE_IN_SECONDS};
 
@@ -160,19 +333,33 @@ class Dog {
     using Bag = std::vector<FoundObject>;
 
     Dog(Id id, std::string name, geom::Point2D position, uint64_t bag_capacity);
+    // Копия пса не привязана к хранилищу DogStates
+    Dog(const Dog& other);
+    Dog& operator=(const Dog& other);
+    ~Dog();
+
     const Id& GetId() const noexcept;
+    // Пёс, перешедший в другую сессию, получает идентификатор в ней
+    void SetId(Id id) noexcept;
+    // Игрок, управляющий псом. Модель его не использует, по нему подписываются снимки сессии
+    std::optional<uint32_t> GetOwnerId() const noexcept;
+    void SetOwnerId(uint32_t owner_id) noexcept;
     const std::string GetName() const noexcept;
-    const geom::Point2D& GetPosition() const noexcept;
-    const geom::Vec2D& GetSpeed() const noexcept;
+    geom::Point2D GetPosition() const noexcept;
+    geom::Vec2D GetSpeed() const noexcept;
     const Bag& GetBag() const noexcept;
+    // Рюкзак, на который есть внешние ссылки, меняется копированием, поэтому выданный указатель
+    // можно хранить в снимках: пока рюкзак не изменился, все они делят одну копию
+    std::shared_ptr<const Bag> ShareBag() const noexcept;
     const Score& GetScore() const noexcept;
     Direction GetDirection() const noexcept;
-    const collision_detector::Gatherer& GetGatherer() const;
+    collision_detector::Gatherer GetGatherer() const;
     const size_t& GetBagCapacity() const noexcept;
     void SetSpeed(geom::Vec2D speed) noexcept;
     void SetPosition(geom::Point2D position) noexcept;
     void SetDirection(Direction direction) noexcept;
-    void SetGatherer() noexcept;
+    // Собиратель от позиции пса в начале тика до носа в его конце
+    void SetGatherer(geom::Point2D previous_position) noexcept;
     void SetScore(size_t score) noexcept;
     bool isFullBag() const noexcept;
     bool isEmptyBag() const noexcept;
@@ -186,40 +373,32 @@ class Dog {
     static void SetMaxInactiveTime(size_t max_inactive_time_in_seconds);
 
    private:
+    friend class DogStates;
+
+    // Состояние, которое хранится в DogStates, пока пёс к нему привязан
+    struct State {
+        geom::Point2D position;
+        geom::Vec2D speed;
+        Direction direction{Direction::NORTH};
+        collision_detector::Gatherer gatherer;
+        std::chrono::milliseconds inactive_time{0};
+        std::chrono::milliseconds live_time{0};
+        bool is_active{true};
+    };
+
+    State GetState() const noexcept;
+    void SetState(const State& state) noexcept;
+
     Id id_;
     std::string name_;
-    geom::Point2D position_;
-    geom::Vec2D speed_;
-    Direction direction_{Direction::NORTH};
-    collision_detector::Gatherer gatherer_;
+    std::optional<uint32_t> owner_id_;
+    State state_;
     size_t bag_capacity_;
-    Bag bag;
+    // Меняется на месте, только если на него больше никто не ссылается
+    std::shared_ptr<Bag> bag_;
     Score score_;
-    std::chrono::milliseconds inactive_time_;
-    std::chrono::milliseconds live_time_;
-    bool is_active_{true};
-};
-
-class RoadIndex {
-   public:
-    struct Roads {
-        std::optional<Road> horizontal;
-        std::optional<Road> vertical;
-    };
-
-    explicit RoadIndex(const Map::Roads& roads);
-
-    Roads GetRoadsAtPoint(Point pt) const noexcept;
-
-   private:
-    using RoadFragment = std::pair<Coord, Coord>;
-    using RoadFragments = std::vector<RoadFragment>;
-    using RoadFragmentsMap = std::unordered_map<Coord, RoadFragments>;
-
-    static void MergeFragments(RoadFragmentsMap& fragments_map);
-
-    RoadFragmentsMap horizontal_roads_;
-    RoadFragmentsMap vertical_roads_;
+    DogStates* states_ = nullptr;
+    size_t slot_ = 0;
 };
 
 bool IsValueInRange(double value, double min_value, double max_value);
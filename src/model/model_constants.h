@@ -1,10 +1,14 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 
 namespace model {
 
 constexpr double DEFAULT_DOG_SPEED = 1.0;
 constexpr double DEFAULT_OFFICE_WIDTH = 1.0;
 constexpr size_t DEFAULT_BAG_CAPACITY = 3;
+// По умолчанию все игроки карты попадают в одну сессию
+constexpr size_t DEFAULT_MAX_PLAYERS_PER_SESSION = SIZE_MAX;
 constexpr double DEFAULT_DOG_WIDTH = 0.3;
 constexpr double DEFAULT_DOG_HEIGHT = 0.5;
 constexpr double DEFAULT_LOOT_WIDTH = 0.0;
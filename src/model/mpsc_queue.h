@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace util {
+
+/*
+ * Ограниченная очередь без блокировок: писать могут несколько потоков, читает один.
+ * Каждая ячейка хранит номер позиции, которую она ждёт: писатель занимает позицию
+ * сравнением с обменом и публикует значение, увеличивая номер ячейки, читатель забирает
+ * значение и освобождает ячейку для следующего круга. Ёмкость - степень двойки.
+ */
+template <typename T>
+class BoundedMpscQueue {
+   public:
+    explicit BoundedMpscQueue(size_t capacity)
+        : cells_{new Cell[capacity]}, mask_{capacity - 1} {
+        if (capacity < 2 || (capacity & mask_) != 0) {
+            throw std::invalid_argument("Queue capacity must be a power of two");
+        }
+        for (size_t i = 0; i < capacity; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMpscQueue(const BoundedMpscQueue&) = delete;
+    BoundedMpscQueue& operator=(const BoundedMpscQueue&) = delete;
+
+    // Можно вызывать из любого потока. Возвращает false, если очередь заполнена
+    bool TryPush(T value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Только для читающего потока. Возвращает false, если готовых значений нет
+    bool TryPop(T& value) {
+        const size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        value = std::move(cell.value);
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        dequeue_pos_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Приблизительная проверка для других потоков: занятая, но ещё не записанная ячейка считается значением
+    bool Empty() const noexcept {
+        return enqueue_pos_.load(std::memory_order_acquire) == dequeue_pos_.load(std::memory_order_acquire);
+    }
+
+    size_t Capacity() const noexcept {
+        return mask_ + 1;
+    }
+
+   private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    // Позиции писателей и читателя на разных линиях кэша, чтобы они не мешали друг другу
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+
+}  // namespace util
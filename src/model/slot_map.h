@@ -0,0 +1,182 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace util {
+
+/*
+ * Хранилище с поколениями (slot map).
+ * Ключ - Tagged-тип над uint32_t: младшие INDEX_BITS бит - номер слота,
+ * старшие GENERATION_BITS бит - поколение слота. При удалении поколение слота
+ * увеличивается, поэтому старый ключ перестаёт находить новое значение в том же слоте.
+ * Значения лежат в непрерывном массиве: вставка и удаление за O(1), обход без разрывов.
+ * Удаление переносит последнее значение на место удалённого, порядок обхода не сохраняется.
+ */
+template <typename Key, typename Value>
+class SlotMap {
+   public:
+    static constexpr uint32_t INDEX_BITS = 20;
+    static constexpr uint32_t GENERATION_BITS = 32 - INDEX_BITS;
+    static constexpr uint32_t MAX_SLOTS = 1u << INDEX_BITS;
+    static constexpr uint32_t MAX_GENERATION = (1u << GENERATION_BITS) - 1;
+
+    using iterator = typename std::vector<Value>::iterator;
+    using const_iterator = typename std::vector<Value>::const_iterator;
+
+    // Ключ, который получит следующее вставленное значение
+    Key NextKey() const {
+        if (!free_.empty()) {
+            const uint32_t index = free_.back();
+            return MakeKey(index, slots_[index].generation);
+        }
+        if (slots_.size() >= MAX_SLOTS) {
+            throw std::length_error("Slot map is full");
+        }
+        return MakeKey(static_cast<uint32_t>(slots_.size()), 0);
+    }
+
+    Key Insert(Value value) {
+        const Key key = NextKey();
+        const uint32_t index = IndexOf(key);
+        if (index == slots_.size()) {
+            slots_.push_back({});
+        } else {
+            free_.pop_back();
+        }
+        Occupy(index, key, std::move(value));
+        return key;
+    }
+
+    // Вставляет значение под заданным ключом. Нужна при восстановлении сохранённого состояния
+    void InsertAt(Key key, Value value) {
+        const uint32_t index = IndexOf(key);
+        if (index < slots_.size() && slots_[index].dense != FREE) {
+            throw std::invalid_argument("Slot map key is already in use");
+        }
+        while (slots_.size() <= index) {
+            free_.push_back(static_cast<uint32_t>(slots_.size()));
+            slots_.push_back({});
+        }
+        std::erase(free_, index);
+        slots_[index].generation = GenerationOf(key);
+        Occupy(index, key, std::move(value));
+    }
+
+    bool Erase(Key key) {
+        if (!Contains(key)) {
+            return false;
+        }
+        EraseDense(slots_[IndexOf(key)].dense);
+        return true;
+    }
+
+    // Удаляет значения, для которых pred вернул true. Возвращает количество удалённых
+    template <typename Pred>
+    size_t EraseIf(Pred pred) {
+        size_t erased = 0;
+        for (size_t i = values_.size(); i-- > 0;) {
+            if (pred(values_[i])) {
+                EraseDense(static_cast<uint32_t>(i));
+                ++erased;
+            }
+        }
+        return erased;
+    }
+
+    bool Contains(Key key) const noexcept {
+        const uint32_t index = IndexOf(key);
+        return index < slots_.size() && slots_[index].dense != FREE && slots_[index].generation == GenerationOf(key);
+    }
+
+    Value* Find(Key key) noexcept {
+        return Contains(key) ? &values_[slots_[IndexOf(key)].dense] : nullptr;
+    }
+
+    const Value* Find(Key key) const noexcept {
+        return Contains(key) ? &values_[slots_[IndexOf(key)].dense] : nullptr;
+    }
+
+    size_t Size() const noexcept {
+        return values_.size();
+    }
+
+    bool Empty() const noexcept {
+        return values_.empty();
+    }
+
+    // Значения и их ключи в порядке обхода: Keys()[i] - ключ Values()[i]
+    std::span<const Value> Values() const noexcept {
+        return values_;
+    }
+
+    std::span<const Key> Keys() const noexcept {
+        return keys_;
+    }
+
+    iterator begin() noexcept {
+        return values_.begin();
+    }
+    iterator end() noexcept {
+        return values_.end();
+    }
+    const_iterator begin() const noexcept {
+        return values_.begin();
+    }
+    const_iterator end() const noexcept {
+        return values_.end();
+    }
+
+   private:
+    static constexpr uint32_t FREE = UINT32_MAX;
+
+    struct Slot {
+        uint32_t dense = FREE;
+        uint32_t generation = 0;
+    };
+
+    static Key MakeKey(uint32_t index, uint32_t generation) noexcept {
+        return Key{(generation << INDEX_BITS) | index};
+    }
+    static uint32_t IndexOf(const Key& key) noexcept {
+        return *key & (MAX_SLOTS - 1);
+    }
+    static uint32_t GenerationOf(const Key& key) noexcept {
+        return *key >> INDEX_BITS;
+    }
+
+    void Occupy(uint32_t index, Key key, Value&& value) {
+        slots_[index].dense = static_cast<uint32_t>(values_.size());
+        values_.push_back(std::move(value));
+        keys_.push_back(key);
+    }
+
+    void EraseDense(uint32_t dense) {
+        const uint32_t index = IndexOf(keys_[dense]);
+        const uint32_t last = static_cast<uint32_t>(values_.size() - 1);
+        if (dense != last) {
+            values_[dense] = std::move(values_[last]);
+            keys_[dense] = keys_[last];
+            slots_[IndexOf(keys_[dense])].dense = dense;
+        }
+        values_.pop_back();
+        keys_.pop_back();
+
+        auto& slot = slots_[index];
+        slot.dense = FREE;
+        // Слот с исчерпанными поколениями больше не выдаётся, чтобы старые ключи не ожили
+        if (slot.generation < MAX_GENERATION) {
+            ++slot.generation;
+            free_.push_back(index);
+        }
+    }
+
+    std::vector<Value> values_;
+    std::vector<Key> keys_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_;
+};
+
+}  // namespace util
@@ -1,5 +1,6 @@
 #include "ticker.h"
 #include <boost/beast/core.hpp>
+#include <stdexcept>
 
 Ticker::Ticker(std::shared_ptr<Strand> strand, std::chrono::milliseconds period, Handler handler)
     : strand_{strand}, period_{period}, handler_{std::move(handler)},timer_{*strand_} {
@@ -12,8 +13,12 @@ Ticker::Ticker(net::io_context& ioc, std::chrono::milliseconds period, Handler h
 }
 
 void Ticker::Start() {
-    auto last_tick_ = std::chrono::steady_clock::now();
-    /* Выполнить SchedulTick внутри strand_ */
+    last_tick_ = std::chrono::steady_clock::now();
+    ScheduleTick();
+}
+
+void Ticker::ScheduleTick() {
+    /* выполнить OnTick через промежуток времени period_, внутри strand_, если он задан */
     timer_.expires_after(period_);
     if(strand_) {
         timer_.async_wait(net::bind_executor(*strand_, [self = shared_from_this()](sys::error_code ec) {
@@ -26,19 +31,44 @@ void Ticker::Start() {
     }
 }
 
-void Ticker::ScheduleTick() {
-    /* выполнить OnTick через промежуток времени period_ */
-    timer_.expires_after(period_);
-    timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
-        self->OnTick(ec);
-    });
-}
 void Ticker::OnTick(sys::error_code ec) {
     if (!ec) {
         auto current_tick = std::chrono::steady_clock::now();
         auto delta = duration_cast<std::chrono::milliseconds>(current_tick - last_tick_);
-        last_tick_ = current_tick;
+        // Отброшенные доли миллисекунды войдут в следующий delta, поэтому сумма delta не отстаёт от часов
+        last_tick_ += delta;
         handler_(delta);
         ScheduleTick();
     }
+}
+
+FixedTimestep::FixedTimestep(std::chrono::milliseconds step, size_t max_catch_up)
+    : step_{step}, max_catch_up_{max_catch_up} {
+    if (step_ <= std::chrono::milliseconds::zero() || max_catch_up_ == 0) {
+        throw std::invalid_argument("Invalid fixed timestep parameters");
+    }
+}
+
+size_t FixedTimestep::Advance(std::chrono::milliseconds elapsed) {
+    accumulator_ += elapsed;
+    auto steps = static_cast<size_t>(accumulator_ / step_);
+    accumulator_ -= step_ * static_cast<int64_t>(steps);
+    if (steps > max_catch_up_) {
+        skipped_ += steps - max_catch_up_;
+        steps = max_catch_up_;
+    }
+    if (steps > 1) {
+        late_ += steps - 1;
+    }
+    steps_ += steps;
+    return steps;
+}
+
+std::chrono::milliseconds FixedTimestep::GetStep() const noexcept {
+    return step_;
+}
+
+FixedTimestep::Stats FixedTimestep::GetStats() const noexcept {
+    return {steps_.load(std::memory_order_relaxed), late_.load(std::memory_order_relaxed),
+            skipped_.load(std::memory_order_relaxed)};
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
+#include <atomic>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 
@@ -28,4 +30,38 @@ class Ticker : public std::enable_shared_from_this<Ticker> {
     std::chrono::milliseconds period_;
     Handler handler_;
     std::chrono::steady_clock::time_point last_tick_;
-};
\ No newline at end of file
+};
+
+/*
+ * Симуляция с шагом фиксированной длины. Накапливает реально прошедшее время
+ * и сообщает, сколько шагов нужно выполнить, чтобы время симуляции догнало его.
+ * За один вызов выполняется не больше max_catch_up шагов, время остальных отбрасывается:
+ * иначе при нехватке процессора отставание росло бы лавинообразно.
+ */
+class FixedTimestep {
+   public:
+    struct Stats {
+        // Выполненные шаги
+        uint64_t steps = 0;
+        // Шаги, выполненные с опозданием, чтобы догнать реальное время
+        uint64_t late = 0;
+        // Шаги, пропущенные из-за ограничения max_catch_up
+        uint64_t skipped = 0;
+    };
+
+    FixedTimestep(std::chrono::milliseconds step, size_t max_catch_up);
+
+    // Добавляет прошедшее время и возвращает число шагов, которые нужно выполнить
+    size_t Advance(std::chrono::milliseconds elapsed);
+    std::chrono::milliseconds GetStep() const noexcept;
+    // Можно вызывать из любого потока
+    Stats GetStats() const noexcept;
+
+   private:
+    std::chrono::milliseconds step_;
+    size_t max_catch_up_;
+    std::chrono::milliseconds accumulator_{0};
+    std::atomic<uint64_t> steps_{0};
+    std::atomic<uint64_t> late_{0};
+    std::atomic<uint64_t> skipped_{0};
+};
@@ -1,122 +1,171 @@
 #include "api_handler.h"
 
 #include <boost/url/parse.hpp>
+#include <charconv>
 
 #include "json_deserializer.h"
 #include "json_serializer.h"
 
 namespace http_handler {
 
+namespace url_invariants {
+
+const std::string URL_PARAMETER_START = "start";
+const std::string URL_PARAMETER_MAX_ITEMS = "maxItems";
+const std::string URL_PARAMETER_SINCE = "since";
+
+}  // namespace url_invariants
+
 ApiHandler::ApiHandler(std::shared_ptr<Application> app) : app_{app} {
 }
 
-bool ApiHandler::isApiRequest(const StringRequest& request) {
+bool ApiHandler::isApiRequest(const StringRequest& request) const {
     auto target = request.target();
     return target.starts_with(API::IS_API);
 };
 
-StringResponse ApiHandler::ApiHandlerRequest(const StringRequest& request) {
-    request_ = std::move(request);
-    auto target = request_.target();
+std::optional<Token> ApiHandler::ExtractToken(const StringRequest& request) {
+    auto it = request.find(http::field::authorization);
+    if (it == request.end()) {
+        return std::nullopt;
+    }
+    auto value = it->value();
+    if (!value.starts_with(TOKEN_BEARER) || value.size() != BEARER_AUTHORIZATION_TOKEN_SIZE) {
+        return std::nullopt;
+    }
+    return Token{std::string{value.begin() + TOKEN_BEARER_SIZE, value.begin() + BEARER_AUTHORIZATION_TOKEN_SIZE}};
+}
+
+std::shared_ptr<GameSession> ApiHandler::RouteRequest(const StringRequest& request) const {
+    auto target = request.target();
+    if (target == API::JOIN_GAME && request.method() == http::verb::post) {
+        auto it = request.find(http::field::content_type);
+        if (it != request.end() && !beast::iequals(it->value(), ContentType::APPLICATION_JSON)) {
+            return nullptr;
+        }
+        // Сессия выбирается заранее: игрок входит в неё уже из её strand
+        try {
+            auto data_join = json_deserializer::ExtractJoinGameDataFromRequest(request.body());
+            if (data_join.first.empty()) {
+                return nullptr;
+            }
+            return app_->SelectSessionForJoin(data_join.second);
+        } catch (const std::exception&) {
+            // Ошибку разбора вернёт JoinGame
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+StringResponse ApiHandler::ApiHandlerRequest(const StringRequest& request, const std::shared_ptr<GameSession>& session) const {
+    auto target = request.target();
     if (target == API::MAPS)
-        return ListOfMaps();
+        return ListOfMaps(request);
 
     if (target.starts_with(API::MAP_ID))
-        return GetMap();
+        return GetMap(request);
 
     if (target == API::JOIN_GAME)
-        return JoinGame();
+        return JoinGame(request, session);
 
     if (target == API::LIST_PLAYERS)
-        return ListOfPlayers();
+        return ListOfPlayers(request);
 
-    if (target == API::GAME_STATE)
-        return GetGameState();
+    // Запрос состояния может нести параметр since
+    if (target.substr(0, target.find('?')) == API::GAME_STATE)
+        return GetGameState(request);
 
     if (target == API::PLAYER_ACTION)
-        return GetPlayerAction();
+        return GetPlayerAction(request);
 
     if (target == API::TICK)
-        return Tick();
+        return Tick(request);
 
     if (target.starts_with(API::RECORD))
-        return Record();
+        return Record(request);
 
     auto response = json_serializer::ErrorMsg("badRequest", "Bad request");
     return MakeStringResponse(http::status::bad_request, std::string_view{response}, request.version(), request.keep_alive(),
                               ContentType::APPLICATION_JSON, "no-cache"sv);
 }
 
-StringResponse ApiHandler::ListOfMaps() {
-    if (request_.method() == http::verb::get || request_.method() == http::verb::head) {
+StringResponse ApiHandler::ListOfMaps(const StringRequest& request) const {
+    if (request.method() == http::verb::get || request.method() == http::verb::head) {
         const auto& maps = app_->ListMaps();
         auto response = json_serializer::SerializeListOfMaps(maps);
-        return MakeStringResponse(http::status::ok, std::string_view{response}, request_.version(), request_.keep_alive(),
+        return MakeStringResponse(http::status::ok, std::string_view{response}, request.version(), request.keep_alive(),
                                   ContentType::APPLICATION_JSON, "no-cache"sv);
     }
     auto response = json_serializer::ErrorMsg("invalidMethod", "Invalid method");
-    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                               ContentType::APPLICATION_JSON, "no-cache"sv, "GET, HEAD"sv);
 }
 
-StringResponse ApiHandler::GetMap() {
-    if (request_.method() == http::verb::get || request_.method() == http::verb::head) {
-        std::string id = std::string{request_.target().substr(API::MAP_ID.size(), request_.target().size())};
+StringResponse ApiHandler::GetMap(const StringRequest& request) const {
+    if (request.method() == http::verb::get || request.method() == http::verb::head) {
+        std::string id = std::string{request.target().substr(API::MAP_ID.size(), request.target().size())};
         const auto map = app_->FindMap(id);
         if (map) {
             auto response = json_serializer::Serialize(*map);
-            return MakeStringResponse(http::status::ok, std::string_view{response}, request_.version(), request_.keep_alive(),
+            return MakeStringResponse(http::status::ok, std::string_view{response}, request.version(), request.keep_alive(),
                                       ContentType::APPLICATION_JSON, "no-cache"sv, "GET, HEAD"sv);
         } else {
             auto response = json_serializer::ErrorMsg("mapNotFound", "Map not found");
-            return MakeStringResponse(http::status::not_found, std::string_view{response}, request_.version(), request_.keep_alive(),
+            return MakeStringResponse(http::status::not_found, std::string_view{response}, request.version(), request.keep_alive(),
                                       ContentType::APPLICATION_JSON, "no-cache"sv);
         }
     }
     auto response = json_serializer::ErrorMsg("invalidMethod", "Invalid method");
-    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                               ContentType::APPLICATION_JSON, "no-cache"sv, "GET, HEAD"sv);
 }
 
-StringResponse ApiHandler::JoinGame() {
-    if (request_.method() == http::verb::post) {
-        auto it = request_.find(http::field::content_type);
-        if (it == request_.end() || beast::iequals(it->value(), ContentType::APPLICATION_JSON)) {
+StringResponse ApiHandler::JoinGame(const StringRequest& request, const std::shared_ptr<GameSession>& session) const {
+    if (request.method() == http::verb::post) {
+        auto it = request.find(http::field::content_type);
+        if (it == request.end() || beast::iequals(it->value(), ContentType::APPLICATION_JSON)) {
             std::pair<std::string, std::string> data_join;
             try {
-                data_join = json_deserializer::ExtractJoinGameDataFromRequest(request_.body());
+                data_join = json_deserializer::ExtractJoinGameDataFromRequest(request.body());
             } catch (const std::exception& e) {
                 auto response = json_serializer::ErrorMsg("invalidArgument", "Join game request parse error");
-                return MakeStringResponse(http::status::bad_request, std::string_view{response}, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::bad_request, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             }
             if (data_join.first.empty()) {
                 auto response = json_serializer::ErrorMsg("invalidArgument", "Invalid name");
-                return MakeStringResponse(http::status::bad_request, std::string_view{response}, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::bad_request, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             }
-            auto join_data = app_->JoinGame(data_join.second, data_join.first);
-            if (join_data.first.empty() && join_data.second.empty()) {
+            if (!session) {
                 auto response = json_serializer::ErrorMsg("mapNotFound", "Map not found");
-                return MakeStringResponse(http::status::not_found, std::string_view{response}, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::not_found, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             }
-            auto response = json_serializer::JoinGame(join_data.first, join_data.second);
-            return MakeStringResponse(http::status::ok, std::string_view{response}, request_.version(), request_.keep_alive(),
+            auto join_data = app_->JoinGame(session, std::move(data_join.first));
+            if (!join_data) {
+                // Сессию закрыли, пока запрос ждал её strand. Повторный запрос попадёт в другую
+                auto response = json_serializer::ErrorMsg("sessionClosed", "Session was closed, try again");
+                return MakeStringResponse(http::status::service_unavailable, std::string_view{response}, request.version(), request.keep_alive(),
+                                          ContentType::APPLICATION_JSON, "no-cache"sv);
+            }
+            auto response = json_serializer::JoinGame(join_data->first, join_data->second);
+            return MakeStringResponse(http::status::ok, std::string_view{response}, request.version(), request.keep_alive(),
                                       ContentType::APPLICATION_JSON, "no-cache"sv);
         }
     }
     auto response = json_serializer::ErrorMsg("invalidMethod", "Only POST method is expected");
-    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                               ContentType::APPLICATION_JSON, "no-cache"sv, "POST"sv);
 }
 
-StringResponse ApiHandler::ListOfPlayers() {
-    if (request_.method() == http::verb::get || request_.method() == http::verb::head) {
-        auto it = request_.find(http::field::authorization);
-        if (it == request_.end()) {
+StringResponse ApiHandler::ListOfPlayers(const StringRequest& request) const {
+    if (request.method() == http::verb::get || request.method() == http::verb::head) {
+        auto it = request.find(http::field::authorization);
+        if (it == request.end()) {
             auto response = json_serializer::ErrorMsg("invalidToken", "Authorization header is missing");
-            return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request_.version(), request_.keep_alive(),
+            return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request.version(), request.keep_alive(),
                                       ContentType::APPLICATION_JSON, "no-cache"sv);
         }
         auto value = it->value();
@@ -126,133 +175,167 @@ StringResponse ApiHandler::ListOfPlayers() {
             auto players = app_->ListPlayers(token);
             if (players.size() != 0) {
                 auto response = json_serializer::SerializeListOfPlayers(players);
-                return MakeStringResponse(http::status::ok, std::string_view{response}, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::ok, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             } else {
                 auto response = json_serializer::ErrorMsg("unknownToken", "Player token has not been found");
-                return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             }
         } else {
             auto response = json_serializer::ErrorMsg("invalidToken", "Authorization header is missing");
-            return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request_.version(), request_.keep_alive(),
+            return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request.version(), request.keep_alive(),
                                       ContentType::APPLICATION_JSON, "no-cache"sv);
         }
     }
     auto response = json_serializer::ErrorMsg("invalidMethod", "Invalid method");
-    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                               ContentType::APPLICATION_JSON, "no-cache"sv, "GET, HEAD"sv);
 }
 
-StringResponse ApiHandler::GetGameState() {
-    if (request_.method() == http::verb::get || request_.method() == http::verb::head) {
-        auto it = request_.find(http::field::authorization);
-        if (it == request_.end()) {
+StringResponse ApiHandler::GetGameState(const StringRequest& request) const {
+    if (request.method() == http::verb::get || request.method() == http::verb::head) {
+        auto it = request.find(http::field::authorization);
+        if (it == request.end()) {
             auto response = json_serializer::ErrorMsg("invalidToken", "Authorization header is required");
-            return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request_.version(), request_.keep_alive(),
+            return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request.version(), request.keep_alive(),
                                       ContentType::APPLICATION_JSON, "no-cache"sv);
         }
         auto value = it->value();
         if (value.starts_with(TOKEN_BEARER)) {
             if (value.size() != BEARER_AUTHORIZATION_TOKEN_SIZE) {
                 auto response = json_serializer::ErrorMsg("invalidToken", "Authorization header is required");
-                return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             }
             std::string token_str{value.begin() + TOKEN_BEARER_SIZE, value.begin() + BEARER_AUTHORIZATION_TOKEN_SIZE};
             Token token(std::move(token_str));
             auto game_state = app_->GetGameState(token);
-            if (game_state.players.size() != 0) {
-                auto response = json_serializer::SerializeGameState(game_state);
-                return MakeStringResponse(http::status::ok, std::string_view{response}, request_.version(), request_.keep_alive(),
+            if (game_state) {
+                auto params = boost::urls::url_view{request.target()}.params();
+                if (params.contains(url_invariants::URL_PARAMETER_SINCE)) {
+                    // Клиент знает состояние на тик since: отдаём только изменения или всё заново, если он отстал
+                    const std::string since_str = (*params.find(url_invariants::URL_PARAMETER_SINCE)).value;
+                    uint64_t since = 0;
+                    const auto [end, ec] = std::from_chars(since_str.data(), since_str.data() + since_str.size(), since);
+                    if (ec != std::errc{} || end != since_str.data() + since_str.size()) {
+                        auto response = json_serializer::ErrorMsg("invalidArgument", "Invalid since parameter");
+                        return MakeStringResponse(http::status::bad_request, std::string_view{response}, request.version(), request.keep_alive(),
+                                                  ContentType::APPLICATION_JSON, "no-cache"sv);
+                    }
+                    const auto delta = game_state->DeltaSince(since);
+                    auto response = delta ? json_serializer::SerializeGameStateDelta(*game_state, since, *delta)
+                                          : json_serializer::SerializeGameStateResync(*game_state);
+                    return MakeStringResponse(http::status::ok, std::string_view{response}, request.version(), request.keep_alive(),
+                                              ContentType::APPLICATION_JSON, "no-cache"sv);
+                }
+                // Все игроки сессии получают одну строку, сериализованную на тик
+                const auto& response = game_state->GetSerialized([](const GameSession::Snapshot& snapshot) {
+                    return json_serializer::SerializeGameState(snapshot);
+                });
+                return MakeStringResponse(http::status::ok, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             } else {
                 auto response = json_serializer::ErrorMsg("unknownToken", "Player token has not been found");
-                return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             }
         }
         auto response = json_serializer::ErrorMsg("invalidMethod", "Only POST method is expected");
-        return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+        return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                                   ContentType::APPLICATION_JSON, "no-cache"sv, "POST"sv);
     }
     auto response = json_serializer::ErrorMsg("invalidMethod", "Invalid method");
-    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                               ContentType::APPLICATION_JSON, "no-cache"sv, "GET, HEAD"sv);
 }
 
-StringResponse ApiHandler::GetPlayerAction() {
-    if (request_.method() == http::verb::post) {
-        auto it = request_.find(http::field::authorization);
-        if (it == request_.end()) {
+StringResponse ApiHandler::GetPlayerAction(const StringRequest& request) const {
+    if (request.method() == http::verb::post) {
+        auto it = request.find(http::field::authorization);
+        if (it == request.end()) {
             auto response = json_serializer::ErrorMsg("invalidToken", "Authorization header is required");
-            return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request_.version(), request_.keep_alive(),
+            return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request.version(), request.keep_alive(),
                                       ContentType::APPLICATION_JSON, "no-cache"sv);
         }
         auto value = it->value();
         if (value.starts_with(TOKEN_BEARER)) {
             if (value.size() != BEARER_AUTHORIZATION_TOKEN_SIZE) {
                 auto response = json_serializer::ErrorMsg("invalidToken", "Authorization header is required");
-                return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             }
             std::string token_str{value.begin() + TOKEN_BEARER_SIZE, value.begin() + BEARER_AUTHORIZATION_TOKEN_SIZE};
             Token token(std::move(token_str));
-            auto game_state = app_->GetGameState(token);
-            if (game_state.players.size() != 0) {
-                auto direction = json_deserializer::ExtractMoveAction(request_.body());
-                app_->MovePlayer(token, direction);
-                return MakeStringResponse(http::status::ok, "{}"sv, request_.version(), request_.keep_alive(),
-                                          ContentType::APPLICATION_JSON, "no-cache"sv);
-            } else {
-                auto response = json_serializer::ErrorMsg("unknownToken", "Player token has not been found");
-                return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request_.version(), request_.keep_alive(),
-                                          ContentType::APPLICATION_JSON, "no-cache"sv);
+            if (app_->GetSessionByToken(token)) {
+                auto direction = ParsePlayerAction(request);
+                if (auto* response = std::get_if<StringResponse>(&direction)) {
+                    return std::move(*response);
+                }
+                switch (app_->MovePlayer(token, std::get<std::optional<model::Direction>>(direction))) {
+                    case MoveResult::OK:
+                        return MakeStringResponse(http::status::ok, "{}"sv, request.version(), request.keep_alive(),
+                                                  ContentType::APPLICATION_JSON, "no-cache"sv);
+                    case MoveResult::QUEUE_FULL: {
+                        auto response = json_serializer::ErrorMsg("tooManyActions", "Too many pending actions");
+                        return MakeStringResponse(http::status::service_unavailable, std::string_view{response}, request.version(), request.keep_alive(),
+                                                  ContentType::APPLICATION_JSON, "no-cache"sv);
+                    }
+                    case MoveResult::UNKNOWN_PLAYER:
+                        // Игрока удалили после проверки токена
+                        break;
+                }
             }
+            auto response = json_serializer::ErrorMsg("unknownToken", "Player token has not been found");
+            return MakeStringResponse(http::status::unauthorized, std::string_view{response}, request.version(), request.keep_alive(),
+                                      ContentType::APPLICATION_JSON, "no-cache"sv);
         }
         auto response = json_serializer::ErrorMsg("invalidMethod", "Only POST method is expected");
-        return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+        return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                                   ContentType::APPLICATION_JSON, "no-cache"sv, "POST"sv);
     }
     auto response = json_serializer::ErrorMsg("invalidMethod", "Invalid method");
-    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                               ContentType::APPLICATION_JSON, "no-cache"sv, "GET, HEAD"sv);
 }
 
-StringResponse ApiHandler::Tick() {
-    if (request_.method() == http::verb::post) {
-        auto it = request_.find(http::field::content_type);
-        if (it == request_.end() || beast::iequals(it->value(), ContentType::APPLICATION_JSON)) {
+std::variant<std::optional<model::Direction>, StringResponse> ApiHandler::ParsePlayerAction(const StringRequest& request) {
+    try {
+        return MoveActionToDirection(json_deserializer::ExtractMoveAction(request.body()));
+    } catch (const std::exception& e) {
+        auto response = json_serializer::ErrorMsg("invalidArgument", "Failed to parse action");
+        return MakeStringResponse(http::status::bad_request, std::string_view{response}, request.version(), request.keep_alive(),
+                                  ContentType::APPLICATION_JSON, "no-cache"sv);
+    }
+}
+
+StringResponse ApiHandler::Tick(const StringRequest& request) const {
+    if (request.method() == http::verb::post) {
+        auto it = request.find(http::field::content_type);
+        if (it == request.end() || beast::iequals(it->value(), ContentType::APPLICATION_JSON)) {
             std::chrono::milliseconds delta_time{0};
             try {
-                delta_time = json_deserializer::ExtractDeltaTime(request_.body());
+                delta_time = json_deserializer::ExtractDeltaTime(request.body());
                 app_->Tick(delta_time);
-                return MakeStringResponse(http::status::ok, "{}"sv, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::ok, "{}"sv, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             } catch (const std::exception& e) {
                 auto response = json_serializer::ErrorMsg("invalidArgument", "Failed to parse tick request JSON");
-                return MakeStringResponse(http::status::bad_request, std::string_view{response}, request_.version(), request_.keep_alive(),
+                return MakeStringResponse(http::status::bad_request, std::string_view{response}, request.version(), request.keep_alive(),
                                           ContentType::APPLICATION_JSON, "no-cache"sv);
             }
         }
     }
     auto response = json_serializer::ErrorMsg("invalidMethod", "Invalid method");
-    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                               ContentType::APPLICATION_JSON, "no-cache"sv, "GET, HEAD"sv);
 }
 
-namespace url_invariants {
-
-const std::string URL_PARAMETER_START = "start";
-const std::string URL_PARAMETER_MAX_ITEMS = "maxItems";
-
-}  // namespace url_invariants
-
-StringResponse ApiHandler::Record() {
-    if (request_.method() == http::verb::get) {
+StringResponse ApiHandler::Record(const StringRequest& request) const {
+    if (request.method() == http::verb::get) {
         std::optional<size_t> offset;
         std::optional<size_t> limit;
-        auto params = boost::urls::url_view{request_.target()}.params();
+        auto params = boost::urls::url_view{request.target()}.params();
 
         if (params.contains(url_invariants::URL_PARAMETER_START)) {
             offset = GetValueFromUrlParameter<size_t>(params, url_invariants::URL_PARAMETER_START);
@@ -263,11 +346,11 @@ StringResponse ApiHandler::Record() {
         }
         auto records = app_->GetRecords(offset, limit);
         auto response = json_serializer::SerializeRecords(records.value());
-        return MakeStringResponse(http::status::ok, std::string_view{response}, request_.version(), request_.keep_alive(),
+        return MakeStringResponse(http::status::ok, std::string_view{response}, request.version(), request.keep_alive(),
                                   ContentType::APPLICATION_JSON, "no-cache"sv);
     }
     auto response = json_serializer::ErrorMsg("invalidMethod", "Invalid method");
-    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request_.version(), request_.keep_alive(),
+    return MakeStringResponse(http::status::method_not_allowed, std::string_view{response}, request.version(), request.keep_alive(),
                               ContentType::APPLICATION_JSON, "no-cache"sv, "GET, HEAD"sv);
 }
 
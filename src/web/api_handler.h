@@ -1,6 +1,8 @@
 #pragma once
 #include <boost/url/params_view.hpp>
+#include <optional>
 #include <string_view>
+#include <variant>
 
 #include "application.h"
 #include "model.h"
@@ -35,24 +37,36 @@ struct API {
     constexpr static std::string_view RECORD{"/api/v1/game/records"};
 };
 
+/*
+ * Обработчик не хранит состояния запроса, поэтому запросы выполняются параллельно
+ * в потоках, принявших их. Состояние сессий читается из опубликованных снимков,
+ * а запросы, меняющие состав сессии, выполняются в её strand: RouteRequest находит
+ * сессию, а вызывающий передаёт её в ApiHandlerRequest уже из её strand.
+ */
 class ApiHandler {
    public:
     explicit ApiHandler(std::shared_ptr<Application> app);
-    bool isApiRequest(const StringRequest& request);
-    StringResponse ApiHandlerRequest(const StringRequest& request);
+    bool isApiRequest(const StringRequest& request) const;
+    // Сессия, в strand которой надо выполнить запрос. nullptr - подходит любой поток
+    std::shared_ptr<GameSession> RouteRequest(const StringRequest& request) const;
+    StringResponse ApiHandlerRequest(const StringRequest& request, const std::shared_ptr<GameSession>& session) const;
+    // Направление из тела запроса действия игрока или ответ 400, если тело не разобрано
+    // или действие неизвестно
+    static std::variant<std::optional<model::Direction>, StringResponse> ParsePlayerAction(const StringRequest& request);
 
    private:
-    StringResponse ListOfMaps();
-    StringResponse GetMap();
-    StringResponse JoinGame();
-    StringResponse ListOfPlayers();
-    StringResponse GetGameState();
-    StringResponse GetPlayerAction();
-    StringResponse Tick();
-    StringResponse Record();
+    StringResponse ListOfMaps(const StringRequest& request) const;
+    StringResponse GetMap(const StringRequest& request) const;
+    StringResponse JoinGame(const StringRequest& request, const std::shared_ptr<GameSession>& session) const;
+    StringResponse ListOfPlayers(const StringRequest& request) const;
+    StringResponse GetGameState(const StringRequest& request) const;
+    StringResponse GetPlayerAction(const StringRequest& request) const;
+    StringResponse Tick(const StringRequest& request) const;
+    StringResponse Record(const StringRequest& request) const;
+    // Токен из заголовка Authorization, если он правильного вида
+    static std::optional<Token> ExtractToken(const StringRequest& request);
 
     std::shared_ptr<Application> app_;
-    StringRequest request_;
     constexpr static auto TOKEN_BEARER = "Bearer"sv;
     constexpr static auto TOKEN_BEARER_SIZE = TOKEN_BEARER.size() + 1;
     constexpr static auto BEARER_AUTHORIZATION_TOKEN_SIZE = TOKEN_BEARER_SIZE + 32;
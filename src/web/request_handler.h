@@ -19,8 +19,8 @@ using JsonResponse = http::response<http::string_body>;
 
 class RequestHandler : public std::enable_shared_from_this<RequestHandler> {
    public:
-    explicit RequestHandler(std::shared_ptr<Application> app, std::filesystem::path& root, net::strand<net::io_context::executor_type> strand)
-        : api_handler(app), file_handler(root), strand_{strand} {
+    explicit RequestHandler(std::shared_ptr<Application> app, std::filesystem::path& root)
+        : api_handler(app), file_handler(root) {
     }
 
     RequestHandler(const RequestHandler&) = delete;
@@ -28,12 +28,18 @@ class RequestHandler : public std::enable_shared_from_this<RequestHandler> {
 
     template <typename Body, typename Allocator, typename Send>
     void operator()(tcp::endpoint&& endpoint, http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-        if (api_handler.isApiRequest(std::move(req))) {
-            auto handle = [self = shared_from_this(), send, req = std::forward<decltype(req)>(req)] {
-                assert(self->strand_.running_in_this_thread());
-                return send(self->api_handler.ApiHandlerRequest(req));
+        if (api_handler.isApiRequest(req)) {
+            // Запросы к разным сессиям не ждут друг друга, остальные выполняются сразу
+            auto session = api_handler.RouteRequest(req);
+            if (!session) {
+                return send(api_handler.ApiHandlerRequest(req, nullptr));
+            }
+            auto strand = session->GetStrand();
+            auto handle = [self = shared_from_this(), send, req = std::forward<decltype(req)>(req), session = std::move(session)] {
+                assert(session->GetStrand()->running_in_this_thread());
+                return send(self->api_handler.ApiHandlerRequest(req, session));
             };
-            return net::dispatch(strand_, handle);
+            return net::dispatch(*strand, std::move(handle));
         } else {
             std::visit(
                 [&send](auto&& result) {
@@ -46,7 +52,6 @@ class RequestHandler : public std::enable_shared_from_this<RequestHandler> {
    private:
     ApiHandler api_handler;
     FileHandler file_handler;
-    net::strand<net::io_context::executor_type> strand_;
 };
 
 }  // namespace http_handler
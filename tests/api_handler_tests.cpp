@@ -0,0 +1,49 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+#include "api_handler.h"
+
+using namespace std::literals;
+namespace http = boost::beast::http;
+
+namespace {
+
+const std::string TAG = "[ApiHandler]";
+
+http_handler::StringRequest MakeActionRequest(std::string body) {
+    http_handler::StringRequest request{http::verb::post, http_handler::API::PLAYER_ACTION, 11};
+    request.set(http::field::content_type, "application/json"sv);
+    request.body() = std::move(body);
+    request.prepare_payload();
+    return request;
+}
+
+void CheckBadRequest(const std::string& body) {
+    auto action = http_handler::ApiHandler::ParsePlayerAction(MakeActionRequest(body));
+    const auto* response = std::get_if<http_handler::StringResponse>(&action);
+    REQUIRE(response);
+    CHECK(response->result() == http::status::bad_request);
+    CHECK(response->body().find("invalidArgument"s) != std::string::npos);
+}
+
+}  // namespace
+
+TEST_CASE("Player action is parsed into a direction", TAG) {
+    auto action = http_handler::ApiHandler::ParsePlayerAction(MakeActionRequest(R"({"move":"L"})"s));
+    REQUIRE(std::holds_alternative<std::optional<model::Direction>>(action));
+    CHECK(std::get<std::optional<model::Direction>>(action) == model::Direction::WEST);
+
+    action = http_handler::ApiHandler::ParsePlayerAction(MakeActionRequest(R"({"move":""})"s));
+    REQUIRE(std::holds_alternative<std::optional<model::Direction>>(action));
+    CHECK_FALSE(std::get<std::optional<model::Direction>>(action));
+}
+
+TEST_CASE("Player action with an unknown move is a bad request", TAG) {
+    CheckBadRequest(R"({"move":"X"})"s);
+}
+
+TEST_CASE("Player action with a malformed body is a bad request", TAG) {
+    CheckBadRequest("{move"s);
+    CheckBadRequest(R"({"direction":"L"})"s);
+    CheckBadRequest(R"({"move":7})"s);
+}
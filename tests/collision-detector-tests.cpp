@@ -5,7 +5,10 @@
 #define _USE_MATH_DEFINES
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
 #include <memory>
+#include <random>
+#include <thread>
 #include <string>
 
 #include "collision_detector.h"
@@ -217,4 +220,244 @@ TEST_CASE("Two gathers collect three items moving on x-axis and y-axis", TAG) {
     CHECK(events[2].gatherer_id == 1);
     CHECK_THAT(events[2].sq_distance, WithinRel(0.0, 1e-9));
     CHECK_THAT(events[2].time, WithinRel((item2.GetPosition().x / gatherer2.end_pos.x), 1e-9));
+}
+TEST_CASE("Grid broadphase finds the same events as brute force on random scenes", TAG) {
+    std::mt19937 generator{42};
+    std::uniform_real_distribution<double> coord{0.0, 100.0};
+    std::uniform_real_distribution<double> step{-10.0, 10.0};
+    std::uniform_real_distribution<double> width{0.0, 0.6};
+    std::bernoulli_distribution axis_aligned{0.5};
+
+    for (int scene = 0; scene < 50; ++scene) {
+        collision_detector::ItemGathererProviderImpl provider;
+        for (int i = 0; i < 200; ++i) {
+            provider.AddItem({{coord(generator), coord(generator)}, width(generator)});
+        }
+        for (int g = 0; g < 50; ++g) {
+            geom::Point2D start{coord(generator), coord(generator)};
+            geom::Point2D end = start;
+            if (axis_aligned(generator)) {
+                end.x += step(generator);
+            } else {
+                end.x += step(generator);
+                end.y += step(generator);
+            }
+            provider.AddGatherer({start, end, width(generator)});
+        }
+        // Собиратель, проходящий через несколько предметов, и неподвижный собиратель
+        provider.AddGatherer({{0, 0}, {100, 100}, 0.6});
+        provider.AddGatherer({{50, 50}, {50, 50}, 0.6});
+
+        for (double cell_size : {0.5, collision_detector::DEFAULT_GRID_CELL_SIZE, 50.0}) {
+            INFO("scene: " << scene << ", cell size: " << cell_size);
+            const auto expected = collision_detector::FindGatherEvents(provider);
+            const auto actual = collision_detector::FindGatherEventsGrid(provider, cell_size);
+            REQUIRE(actual.size() == expected.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                CHECK(actual[i].item_id == expected[i].item_id);
+                CHECK(actual[i].gatherer_id == expected[i].gatherer_id);
+                CHECK(actual[i].sq_distance == expected[i].sq_distance);
+                CHECK(actual[i].time == expected[i].time);
+            }
+        }
+    }
+}
+
+TEST_CASE("Grid broadphase handles empty scenes", TAG) {
+    collision_detector::ItemGathererProviderImpl provider;
+    CHECK(collision_detector::FindGatherEventsGrid(provider).empty());
+    provider.AddGatherer({{0, 0}, {10, 0}, 0.6});
+    CHECK(collision_detector::FindGatherEventsGrid(provider).empty());
+}
+
+TEST_CASE("Axis sweep index finds the same events as brute force", TAG) {
+    std::mt19937 generator{11};
+    std::uniform_real_distribution<double> coord{0.0, 40.0};
+    std::uniform_real_distribution<double> step{-5.0, 5.0};
+    std::uniform_real_distribution<double> width{0.0, 0.6};
+    std::uniform_int_distribution<int> placement{0, 2};
+    std::bernoulli_distribution horizontal{0.5};
+
+    for (int scene = 0; scene < 50; ++scene) {
+        collision_detector::ItemGathererProviderImpl provider;
+        for (int i = 0; i < 200; ++i) {
+            // Предметы на осях горизонтальных и вертикальных дорог и немного вне их
+            geom::Point2D position{coord(generator), coord(generator)};
+            switch (placement(generator)) {
+                case 0:
+                    position.y = std::round(position.y);
+                    break;
+                case 1:
+                    position.x = std::round(position.x);
+                    break;
+            }
+            provider.AddItem({position, width(generator)});
+        }
+        for (int g = 0; g < 50; ++g) {
+            const geom::Point2D start{std::round(coord(generator)), std::round(coord(generator))};
+            geom::Point2D end = start;
+            (horizontal(generator) ? end.x : end.y) += step(generator);
+            provider.AddGatherer({start, end, width(generator)});
+        }
+        // Диагональный собиратель проверяется полным перебором, неподвижный пропускается
+        provider.AddGatherer({{0, 0}, {40, 40}, 0.6});
+        provider.AddGatherer({{20, 20}, {20, 20}, 0.6});
+
+        INFO("scene: " << scene);
+        const auto expected = collision_detector::FindGatherEvents(provider);
+        const auto actual = collision_detector::FindGatherEventsSweep(provider);
+        REQUIRE(actual.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            CHECK(actual[i].item_id == expected[i].item_id);
+            CHECK(actual[i].gatherer_id == expected[i].gatherer_id);
+            CHECK(actual[i].sq_distance == expected[i].sq_distance);
+            CHECK(actual[i].time == expected[i].time);
+        }
+    }
+
+    collision_detector::ItemGathererProviderImpl empty;
+    CHECK(collision_detector::FindGatherEventsSweep(empty).empty());
+    empty.AddGatherer({{0, 0}, {10, 0}, 0.6});
+    CHECK(collision_detector::FindGatherEventsSweep(empty).empty());
+}
+
+TEST_CASE("Batch kernel matches TryCollectPoint for every lane", TAG) {
+    std::mt19937 generator{7};
+    std::uniform_real_distribution<double> coord{-50.0, 50.0};
+    std::uniform_real_distribution<double> width{0.0, 0.6};
+
+    for (size_t count = 0; count < 150; ++count) {
+        const geom::Point2D a{coord(generator), coord(generator)};
+        const geom::Point2D b{coord(generator), coord(generator)};
+        const collision_detector::Gatherer gatherer{a, b, width(generator)};
+        collision_detector::ItemBatch items;
+        for (size_t i = 0; i < count; ++i) {
+            // Часть предметов кладём прямо на отрезок, чтобы были и попадания
+            const double t = std::uniform_real_distribution<double>{-0.2, 1.2}(generator);
+            const geom::Point2D on_segment{a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t + width(generator)};
+            items.Add(i % 2 == 0 ? on_segment : geom::Point2D{coord(generator), coord(generator)}, width(generator));
+        }
+
+        std::vector<double> sq_distances(count);
+        std::vector<double> proj_ratios(count);
+        collision_detector::TryCollectPoints(a, b, items.xs.data(), items.ys.data(), count, sq_distances.data(),
+                                             proj_ratios.data());
+        std::vector<collision_detector::GatheringEvent> expected;
+        for (size_t i = 0; i < count; ++i) {
+            INFO("count: " << count << ", item: " << i);
+            const auto result = collision_detector::TryCollectPoint(a, b, {items.xs[i], items.ys[i]});
+            CHECK(sq_distances[i] == result.sq_distance);
+            CHECK(proj_ratios[i] == result.proj_ratio);
+            if (result.IsCollected(items.widths[i] + gatherer.width)) {
+                expected.push_back({i, 3, result.sq_distance, result.proj_ratio});
+            }
+        }
+
+        std::vector<collision_detector::GatheringEvent> events;
+        collision_detector::CollectBatch(items, gatherer, 3, events);
+        REQUIRE(events.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            CHECK(events[i].item_id == expected[i].item_id);
+            CHECK(events[i].gatherer_id == 3);
+            CHECK(events[i].sq_distance == expected[i].sq_distance);
+            CHECK(events[i].time == expected[i].time);
+        }
+    }
+}
+
+TEST_CASE("Virtual provider adapter matches the templated path", TAG) {
+    std::mt19937 generator{11};
+    std::uniform_real_distribution<double> coord{0.0, 20.0};
+    collision_detector::ItemGathererProviderImpl provider;
+    for (int i = 0; i < 100; ++i) {
+        provider.AddItem({{coord(generator), coord(generator)}, 0.3});
+    }
+    for (int g = 0; g < 20; ++g) {
+        const geom::Point2D start{coord(generator), coord(generator)};
+        provider.AddGatherer({start, {start.x + 3.0, start.y}, 0.6});
+    }
+
+    const collision_detector::ItemGathererProvider& base = provider;
+    const auto expected = collision_detector::FindGatherEvents(provider);
+    const auto actual = collision_detector::FindGatherEvents(base);
+    REQUIRE(actual.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        CHECK(actual[i].item_id == expected[i].item_id);
+        CHECK(actual[i].gatherer_id == expected[i].gatherer_id);
+        CHECK(actual[i].time == expected[i].time);
+    }
+}
+
+TEST_CASE("Parallel search returns the same events as the serial one", TAG) {
+    std::mt19937 generator{5};
+    std::uniform_real_distribution<double> coord{0.0, 60.0};
+    std::uniform_real_distribution<double> step{-2.0, 2.0};
+    collision_detector::ItemGathererProviderImpl provider;
+    for (int i = 0; i < 2000; ++i) {
+        // Предметы на целых координатах дают много событий с одинаковым временем
+        provider.AddItem({{std::round(coord(generator)), std::round(coord(generator))}, 0.0});
+    }
+    for (int g = 0; g < 3000; ++g) {
+        const geom::Point2D start{std::round(coord(generator)), std::round(coord(generator))};
+        provider.AddGatherer({start, {start.x + step(generator), start.y}, 0.6});
+    }
+    const auto expected = collision_detector::FindGatherEvents(provider);
+    REQUIRE(!expected.empty());
+
+    auto check_same = [&expected](const std::vector<collision_detector::GatheringEvent>& actual) {
+        REQUIRE(actual.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            CHECK(actual[i].item_id == expected[i].item_id);
+            CHECK(actual[i].gatherer_id == expected[i].gatherer_id);
+            CHECK(actual[i].sq_distance == expected[i].sq_distance);
+            CHECK(actual[i].time == expected[i].time);
+        }
+    };
+
+    collision_detector::ParallelGatherConfig config;
+    config.min_gatherers = 100;
+    config.gatherers_per_chunk = 97;
+
+    SECTION("helpers run on separate threads") {
+        std::vector<std::jthread> threads;
+        check_same(collision_detector::FindGatherEventsParallel(
+            provider, [&threads](std::function<void()> task) { threads.emplace_back(std::move(task)); }, config));
+    }
+
+    SECTION("axis sweep index") {
+        config.index = collision_detector::GatherIndex::AXIS_SWEEP;
+        std::vector<std::jthread> threads;
+        check_same(collision_detector::FindGatherEventsParallel(
+            provider, [&threads](std::function<void()> task) { threads.emplace_back(std::move(task)); }, config));
+    }
+
+    SECTION("helpers start after the call has returned") {
+        std::vector<std::function<void()>> deferred;
+        check_same(collision_detector::FindGatherEventsParallel(
+            provider, [&deferred](std::function<void()> task) { deferred.push_back(std::move(task)); }, config));
+        for (auto& task : deferred) {
+            task();
+        }
+    }
+
+    SECTION("small scenes fall back to serial search") {
+        config.min_gatherers = 10'000;
+        size_t posted = 0;
+        check_same(collision_detector::FindGatherEventsParallel(
+            provider, [&posted](std::function<void()>) { ++posted; }, config));
+        CHECK(posted == 0);
+    }
+}
+
+TEST_CASE("Parallel search handles scenes without gatherers", TAG) {
+    collision_detector::ItemGathererProviderImpl provider;
+    provider.AddItem({{1.0, 1.0}, 0.0});
+
+    collision_detector::ParallelGatherConfig config;
+    config.min_gatherers = 0;
+    size_t posted = 0;
+    CHECK(collision_detector::FindGatherEventsParallel(
+              provider, [&posted](std::function<void()>) { ++posted; }, config)
+              .empty());
+    CHECK(posted == 0);
 }
\ No newline at end of file
@@ -0,0 +1,564 @@
+#include <algorithm>
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game_session.h"
+
+using namespace std::literals;
+using namespace model;
+
+namespace {
+
+// Счётчик выделений памяти, включаемый на время проверяемого участка
+std::atomic<bool> count_allocations{false};
+std::atomic<size_t> allocations{0};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    if (count_allocations) {
+        ++allocations;
+    }
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+const std::string TAG = "[GameSession]";
+
+// Прямая дорога y = 0 из двух отрезков с перекрёстком в x = 10 и базой на конце
+std::shared_ptr<Map> MakeStraightMap() {
+    Map map{Map::Id{"map"s}, "map"s, 1.0, 3};
+    map.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 10});
+    map.AddRoad(Road{Road::HORIZONTAL, Point{10, 0}, 20});
+    map.AddRoad(Road{Road::VERTICAL, Point{10, -5}, 5});
+    map.AddOffice(Office{Office::Id{"office"s}, Point{20, 0}, Offset{0, 0}, 0.5});
+    map.AddLootType(LootType{});
+    map.BuildRoadIndex();
+    return std::make_shared<Map>(std::move(map));
+}
+
+struct SessionResult {
+    geom::Point2D position;
+    Score score;
+    size_t lost_objects;
+    size_t dogs;
+};
+
+SessionResult RunSession(const std::vector<std::chrono::milliseconds>& ticks) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    Dog::SetMaxInactiveTime(5);
+
+    auto dog = session.AddDog("dog"s, {0.0, 0.0});
+    for (double x : {2.0, 4.0, 6.0, 8.0, 12.0, 14.0}) {
+        session.AddLostObject(0, {x, 0.0}, 10);
+    }
+    session.SetDogDirection(dog->GetId(), Direction::EAST);
+    for (auto tick : ticks) {
+        session.Tick(tick);
+    }
+    return {dog->GetPosition(), dog->GetScore(), session.GetLostObjects().Size(), session.GetDogs().Size()};
+}
+
+}  // namespace
+
+TEST_CASE("One long tick gives the same result as many short ones", TAG) {
+    // Пёс доезжает до конца дороги в x = 20.4 за 20.4 с и стоит ещё 4.9 с - меньше
+    // времени бездействия, после которого он уходит из игры
+    const auto long_tick = RunSession({25300ms});
+    const auto short_ticks = RunSession(std::vector<std::chrono::milliseconds>(506, 50ms));
+
+    CHECK(long_tick.position == short_ticks.position);
+    CHECK(long_tick.position == geom::Point2D{20.4, 0.0});
+    // Рюкзак на три предмета: подобраны первые три, остальные пропущены и остались на карте
+    CHECK(long_tick.score == 30);
+    CHECK(long_tick.score == short_ticks.score);
+    CHECK(long_tick.lost_objects == 3);
+    CHECK(long_tick.lost_objects == short_ticks.lost_objects);
+    CHECK(long_tick.dogs == 1);
+    CHECK(long_tick.dogs == short_ticks.dogs);
+}
+
+TEST_CASE("Tick does not allocate memory in steady state", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    Dog::SetMaxInactiveTime(60);
+
+    std::vector<Dog::Id> dogs;
+    for (int i = 0; i < 16; ++i) {
+        dogs.push_back(session.AddDog("dog"s, {i * 1.25, 0.0})->GetId());
+    }
+    for (int i = 0; i < 40; ++i) {
+        session.AddLostObject(0, {i * 0.5, 0.0}, 1);
+    }
+
+    // Псы ходят по дороге туда и обратно, подбирают предметы и сдают их на базу
+    auto run = [&](int ticks) {
+        for (int tick = 0; tick < ticks; ++tick) {
+            if (tick % 40 == 0) {
+                for (size_t i = 0; i < dogs.size(); ++i) {
+                    const bool east = (tick / 40 + i) % 2 == 0;
+                    // Команды приходят через очередь, как от игроков
+                    REQUIRE(session.PushCommand(dogs[i], east ? Direction::EAST : Direction::WEST));
+                }
+            }
+            session.Tick(50ms);
+        }
+    };
+    run(80);
+
+    allocations = 0;
+    count_allocations = true;
+    run(200);
+    count_allocations = false;
+
+    CHECK(allocations == 0);
+    CHECK(session.GetDogs().Size() == dogs.size());
+}
+
+TEST_CASE("AdvanceTo does not allocate memory in steady state", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    Dog::SetMaxInactiveTime(60);
+
+    std::vector<Dog::Id> dogs;
+    for (int i = 0; i < 16; ++i) {
+        dogs.push_back(session.AddDog("dog"s, {i * 1.25, 0.0})->GetId());
+    }
+    // Предметов не меньше, чем псов, и лежат они в стороне от их пути: генератор ничего не добавляет,
+    // рюкзаки не меняются. Подбор предмета копирует рюкзак, который держат снимки, - это
+    // выделение на событие, а не на тик
+    for (int i = 0; i < 16; ++i) {
+        session.AddLostObject(0, {10.0, -4.0 + i * 0.1}, 1);
+    }
+
+    std::chrono::milliseconds now{0};
+    auto run = [&](int ticks) {
+        for (int tick = 0; tick < ticks; ++tick) {
+            if (tick % 40 == 0) {
+                for (size_t i = 0; i < dogs.size(); ++i) {
+                    const bool east = (tick / 40 + i) % 2 == 0;
+                    REQUIRE(session.PushCommand(dogs[i], east ? Direction::EAST : Direction::WEST));
+                }
+            }
+            now += 50ms;
+            session.AdvanceTo(now);
+        }
+    };
+    // Прогрев заполняет пул снимков и всю историю изменений
+    run(2 * GameSession::Snapshot::HISTORY_SIZE);
+
+    allocations = 0;
+    count_allocations = true;
+    run(200);
+    count_allocations = false;
+
+    CHECK(allocations == 0);
+    const auto snapshot = session.GetSnapshot();
+    CHECK(snapshot->dogs.size() == dogs.size());
+    CHECK(snapshot->lost_objects->size() == 16);
+    // Переиспользованные изменения по-прежнему дают разницу с недавним тиком
+    const auto previous_tick = snapshot->change->previous_tick;
+    REQUIRE(snapshot->DeltaSince(previous_tick));
+}
+
+TEST_CASE("Tick applies only the last queued command of each dog", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+
+    auto first = session.AddDog("first"s, {5.0, 0.0});
+    auto second = session.AddDog("second"s, {5.0, 0.0});
+    REQUIRE(session.PushCommand(first->GetId(), Direction::EAST));
+    REQUIRE(session.PushCommand(second->GetId(), Direction::EAST));
+    REQUIRE(session.PushCommand(first->GetId(), Direction::WEST));
+    REQUIRE(session.PushCommand(second->GetId(), std::nullopt));
+    // Команда псу, которого уже нет, пропускается
+    REQUIRE(session.PushCommand(Dog::Id{100u}, Direction::EAST));
+    // До тика команды не применяются
+    CHECK(first->GetSpeed() == geom::Vec2D{});
+
+    session.Tick(1000ms);
+    CHECK(first->GetDirection() == Direction::WEST);
+    CHECK(first->GetPosition() == geom::Point2D{4.0, 0.0});
+    CHECK(second->GetSpeed() == geom::Vec2D{});
+    CHECK(second->GetPosition() == geom::Point2D{5.0, 0.0});
+}
+
+TEST_CASE("Command queue refuses commands when full", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    auto dog = session.AddDog("dog"s, {0.0, 0.0});
+    for (size_t i = 0; i < GameSession::COMMAND_QUEUE_CAPACITY; ++i) {
+        REQUIRE(session.PushCommand(dog->GetId(), Direction::EAST));
+    }
+    CHECK_FALSE(session.PushCommand(dog->GetId(), Direction::EAST));
+    session.Tick(50ms);
+    CHECK(session.PushCommand(dog->GetId(), Direction::EAST));
+}
+
+TEST_CASE("Idle dog delivers loot picked up after passing the office", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    Dog::SetMaxInactiveTime(60);
+
+    // Нос стоящего пса смотрит на север: сначала задевает базу, затем предмет
+    auto dog = session.AddDog("dog"s, {19.7, 0.0});
+    REQUIRE(dog->GetDirection() == Direction::NORTH);
+    session.AddLostObject(0, {19.7, -0.5}, 10);
+
+    session.Tick(50ms);
+    CHECK(dog->GetBag().size() == 1);
+    CHECK(dog->GetScore() == 0);
+    // Новых предметов нет, но пёс сдаёт подобранное, как если бы проверялся каждый тик
+    session.Tick(50ms);
+    CHECK(dog->GetBag().empty());
+    CHECK(dog->GetScore() == 10);
+    CHECK(session.GetLostObjects().Size() == 0);
+}
+
+TEST_CASE("Dogs leave in the order they stopped", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    Dog::SetMaxInactiveTime(1);
+
+    // Чётные псы стоят с самого начала, нечётные бегут на восток и останавливаются
+    // в конце дороги x = 20.4 через 20.4 - x с
+    std::vector<std::shared_ptr<Dog>> dogs;
+    for (int i = 0; i < 10; ++i) {
+        dogs.push_back(session.AddDog("dog"s, {static_cast<double>(i), 0.0}));
+        if (i % 2 == 1) {
+            session.SetDogDirection(dogs.back()->GetId(), Direction::EAST);
+        }
+    }
+    // Записи ушедших в другую сессию псов удаляются из середины кучи
+    REQUIRE(session.ReleaseDog(dogs[0]->GetId()));
+    REQUIRE(session.ReleaseDog(dogs[4]->GetId()));
+
+    auto advance_to = [&session, elapsed = 0ms](std::chrono::milliseconds time) mutable {
+        for (; elapsed < time; elapsed += 100ms) {
+            session.Tick(100ms);
+        }
+    };
+    advance_to(500ms);
+    CHECK(session.GetDogs().Size() == 8);
+    advance_to(1500ms);
+    CHECK(session.GetDogs().Size() == 5);
+    // Нечётный пёс i уходит через 21.4 - i с
+    for (int remaining : {4, 3, 2, 1, 0}) {
+        advance_to(std::chrono::milliseconds{(21 - 2 * remaining) * 1000});
+        CHECK(session.GetDogs().Size() == static_cast<size_t>(remaining));
+    }
+    Dog::SetMaxInactiveTime(60);
+}
+
+TEST_CASE("Dog moves to another session with its bag and score", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    const auto map = MakeStraightMap();
+    GameSession source{GameSession::Id{0u}, map, LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt, gather_pool};
+    GameSession target{GameSession::Id{1u}, map, LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt, gather_pool};
+
+    auto resident = target.AddDog("resident"s, {0.0, 0.0});
+    auto dog = source.AddDog("dog"s, {0.0, 0.0});
+    source.SetDogDirection(dog->GetId(), Direction::EAST);
+    source.Tick(2000ms);
+    dog->SetScore(42);
+    REQUIRE(dog->AddItemToBag(FoundObject{FoundObject::Id{7u}, 0, 10}));
+
+    target.AdoptDog(source.ReleaseDog(dog->GetId()));
+    CHECK(source.GetDogs().Empty());
+    REQUIRE(target.GetDogs().Size() == 2);
+    // Идентификатор выдан заново и не совпадает с идентификатором жителя сессии
+    CHECK(dog->GetId() != resident->GetId());
+    CHECK(target.GetDogs().Contains(dog->GetId()));
+    CHECK(dog->GetPosition() == geom::Point2D{2.0, 0.0});
+    CHECK(dog->GetScore() == 42);
+    CHECK(dog->GetBag().size() == 1);
+
+    // Пёс продолжает бежать в новой сессии
+    target.Tick(1000ms);
+    CHECK(dog->GetPosition() == geom::Point2D{3.0, 0.0});
+}
+
+TEST_CASE("Dogs move between sessions in a batch", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    const auto map = MakeStraightMap();
+    GameSession source{GameSession::Id{0u}, map, LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt, gather_pool};
+    GameSession target{GameSession::Id{1u}, map, LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt, gather_pool};
+
+    auto resident = target.AddDog("resident"s, {0.0, 0.0});
+    auto first = source.AddDog("first"s, {0.0, 0.0});
+    auto second = source.AddDog("second"s, {1.0, 0.0});
+    auto stays = source.AddDog("stays"s, {2.0, 0.0});
+
+    // Пса, которого уже нет в сессии, заменяет nullptr
+    const auto released = source.ReleaseDogs({first->GetId(), Dog::Id{100u}, second->GetId()});
+    REQUIRE(released.size() == 3);
+    CHECK(released[0] == first);
+    CHECK(released[1] == nullptr);
+    CHECK(released[2] == second);
+    CHECK(source.GetDogs().Size() == 1);
+    CHECK(source.GetSnapshot()->dogs.size() == 1);
+
+    target.AdoptDogs({first, second});
+    REQUIRE(target.GetDogs().Size() == 3);
+    CHECK(target.GetSnapshot()->dogs.size() == 3);
+    CHECK(first->GetId() != second->GetId());
+    CHECK(first->GetId() != resident->GetId());
+    CHECK(second->GetId() != resident->GetId());
+    CHECK(target.GetDogs().Contains(first->GetId()));
+    CHECK(target.GetDogs().Contains(second->GetId()));
+    CHECK(source.GetDogs().Contains(stays->GetId()));
+}
+
+TEST_CASE("Session publishes immutable snapshots", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    CHECK(session.GetSnapshot()->dogs.empty());
+
+    auto dog = session.AddDog("dog"s, {0.0, 0.0});
+    session.SetDogOwner(dog->GetId(), 7);
+    session.AddLostObject(LostObject{LostObject::Id{3u}, 0, {5.0, 0.0}, 10});
+    const auto before = session.GetSnapshot();
+    REQUIRE(before->roster->size() == 1);
+    CHECK(before->roster->front().owner_id == 7u);
+    CHECK(before->roster->front().name == "dog"s);
+    REQUIRE(before->dogs.size() == 1);
+    CHECK(before->dogs.front().owner_id == 7u);
+    REQUIRE(before->lost_objects->size() == 1);
+    CHECK(before->lost_objects->front().id == LostObject::Id{3u});
+
+    REQUIRE(session.PushCommand(dog->GetId(), Direction::EAST));
+    session.AdvanceTo(1000ms);
+    const auto after = session.GetSnapshot();
+    CHECK(after->dogs.front().position == geom::Point2D{1.0, 0.0});
+    // Уже выданный снимок не меняется, а состав сессии тот же, и список участников общий
+    CHECK(before->dogs.front().position == geom::Point2D{0.0, 0.0});
+    CHECK(after->roster == before->roster);
+    // Неизменившиеся рюкзак и предметы снимки тоже делят
+    CHECK(after->dogs.front().bag == before->dogs.front().bag);
+    CHECK(after->lost_objects == before->lost_objects);
+}
+
+TEST_CASE("Changed bag is copied, snapshots keep the old one", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    auto dog = session.AddDog("dog"s, {0.0, 0.0});
+    session.AddLostObject(LostObject{LostObject::Id{0u}, 0, {1.0, 0.0}, 10});
+    const auto before = session.GetSnapshot();
+
+    REQUIRE(session.PushCommand(dog->GetId(), Direction::EAST));
+    session.AdvanceTo(2000ms);
+    const auto after = session.GetSnapshot();
+    REQUIRE(dog->GetBag().size() == 1);
+    CHECK(before->dogs.front().bag->empty());
+    CHECK(after->dogs.front().bag->size() == 1);
+    CHECK(after->dogs.front().bag == dog->ShareBag());
+    CHECK(after->lost_objects != before->lost_objects);
+}
+
+TEST_CASE("Deferred publish makes one snapshot for many changes", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    // Восстановленный пёс запускает генерацию предметов через strand, поэтому сессия в shared_ptr
+    auto session = std::make_shared<GameSession>(GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5},
+                                                 ioc, std::nullopt, gather_pool);
+    const auto initial = session->GetSnapshot();
+    {
+        GameSession::DeferredPublish deferred_publish{*session};
+        for (uint32_t i = 0; i < 3; ++i) {
+            auto dog = std::make_shared<Dog>(Dog::Id{i}, "dog"s, geom::Point2D{0.0, 0.0}, 3);
+            session->AddDog(dog);
+            session->SetDogOwner(dog->GetId(), i);
+            session->AddLostObject(LostObject{LostObject::Id{i}, 0, {5.0, 0.0}, 10});
+        }
+        CHECK(session->GetSnapshot() == initial);
+    }
+    const auto restored = session->GetSnapshot();
+    CHECK(restored != initial);
+    CHECK(restored->dogs.size() == 3);
+    CHECK(restored->lost_objects->size() == 3);
+    // Изменения вне тика войдут в изменение следующего тика
+    CHECK(restored->tick == initial->tick);
+    session->AdvanceTo(0ms);
+    const auto& change = *session->GetSnapshot()->change;
+    CHECK(change.previous_tick == initial->tick);
+    CHECK(change.changed_dogs.size() == 3);
+    CHECK(change.added_lost_objects.size() == 3);
+}
+
+TEST_CASE("Snapshot is serialized once for all readers", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    auto dog = session.AddDog("dog"s, {0.0, 0.0});
+    session.SetDogOwner(dog->GetId(), 0);
+
+    std::atomic<size_t> serializations{0};
+    const auto serializer = [&serializations](const GameSession::Snapshot& snapshot) {
+        ++serializations;
+        return std::to_string(snapshot.dogs.size());
+    };
+    const auto snapshot = session.GetSnapshot();
+    std::vector<std::thread> readers;
+    std::vector<const std::string*> results(8);
+    for (size_t i = 0; i < results.size(); ++i) {
+        readers.emplace_back([&, i] {
+            results[i] = &snapshot->GetSerialized(serializer);
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    CHECK(serializations == 1);
+    for (const auto* result : results) {
+        CHECK(result == results.front());
+        CHECK(*result == "1"s);
+    }
+
+    // Следующий тик публикует новый снимок со своей строкой
+    session.AdvanceTo(50ms);
+    session.GetSnapshot()->GetSerialized(serializer);
+    CHECK(serializations == 2);
+}
+
+TEST_CASE("Snapshot gives changes since an earlier tick", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    auto runner = session.AddDog("runner"s, {0.0, 0.0});
+    session.SetDogOwner(runner->GetId(), 1);
+    auto sitter = session.AddDog("sitter"s, {5.0, 0.0});
+    session.SetDogOwner(sitter->GetId(), 2);
+    auto leaver = session.AddDog("leaver"s, {8.0, 0.0});
+    session.SetDogOwner(leaver->GetId(), 3);
+    session.AddLostObject(LostObject{LostObject::Id{1u}, 0, {9.0, 0.0}, 10});
+    session.AdvanceTo(100ms);
+    const auto known = session.GetSnapshot();
+
+    REQUIRE(session.PushCommand(runner->GetId(), Direction::EAST));
+    session.AdvanceTo(600ms);
+    session.ReleaseDog(leaver->GetId());
+    session.AddLostObject(LostObject{LostObject::Id{2u}, 0, {3.0, -5.0}, 10});
+    // Уход пса и новый предмет попадают в изменение тика, следующего за ними
+    session.AdvanceTo(600ms);
+    const auto current = session.GetSnapshot();
+    REQUIRE(current->tick > known->tick);
+
+    const auto delta = current->DeltaSince(known->tick);
+    REQUIRE(delta);
+    // Стоящий пёс не изменился и в разницу не попадает
+    REQUIRE(delta->changed_dogs.size() == 1);
+    CHECK(delta->changed_dogs.front()->owner_id == 1u);
+    CHECK(delta->changed_dogs.front()->position == geom::Point2D{0.5, 0.0});
+    CHECK(delta->removed_owners == std::vector<uint32_t>{3});
+    // Генератор мог добавить и свои предметы, но старый предмет среди новых не появляется
+    CHECK(std::ranges::count(delta->added_lost_objects, LostObject::Id{2u}, &GameSession::Snapshot::LostObjectState::id) == 1);
+    CHECK(std::ranges::count(delta->added_lost_objects, LostObject::Id{1u}, &GameSession::Snapshot::LostObjectState::id) == 0);
+    CHECK(delta->removed_lost_objects.empty());
+
+    CHECK(current->DeltaSince(current->tick)->changed_dogs.empty());
+    // Номер из будущего - полное состояние
+    CHECK_FALSE(current->DeltaSince(current->tick + 1));
+}
+
+TEST_CASE("Client behind the snapshot history needs full state", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    GameSession session{GameSession::Id{0u}, MakeStraightMap(), LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt,
+                        gather_pool};
+    auto dog = session.AddDog("dog"s, {0.0, 0.0});
+    session.SetDogOwner(dog->GetId(), 0);
+    const auto known = session.GetSnapshot()->tick;
+    std::vector<uint64_t> ticks;
+    for (size_t i = 0; i < GameSession::Snapshot::HISTORY_SIZE; ++i) {
+        session.AdvanceTo(std::chrono::milliseconds{i + 1});
+        ticks.push_back(session.GetSnapshot()->tick);
+        // Публикации вне тика места в истории не занимают
+        session.SetDogDirection(dog->GetId(), std::nullopt);
+    }
+    // История ещё покрывает все тики после known
+    CHECK(session.GetSnapshot()->DeltaSince(known));
+
+    session.AdvanceTo(std::chrono::milliseconds{GameSession::Snapshot::HISTORY_SIZE + 1});
+    const auto current = session.GetSnapshot();
+    CHECK_FALSE(current->DeltaSince(known));
+    CHECK(current->DeltaSince(ticks.front()));
+    // Цепочка изменений оборвана: старые изменения освобождаются
+    size_t chain_length = 0;
+    for (auto change = current->change; change; change = change->previous.load()) {
+        ++chain_length;
+    }
+    CHECK(chain_length == GameSession::Snapshot::HISTORY_SIZE);
+}
+
+TEST_CASE("Client of a moved dog gets full state from the new session", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    const auto map = MakeStraightMap();
+    GameSession source{GameSession::Id{0u}, map, LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt, gather_pool};
+    GameSession target{GameSession::Id{1u}, map, LootGeneratorConfig{1.0, 0.5}, ioc, std::nullopt, gather_pool};
+    auto resident = target.AddDog("resident"s, {0.0, 0.0});
+    target.SetDogOwner(resident->GetId(), 1);
+    auto dog = source.AddDog("dog"s, {0.0, 0.0});
+    source.SetDogOwner(dog->GetId(), 2);
+    for (int i = 1; i <= 3; ++i) {
+        source.AdvanceTo(std::chrono::milliseconds{i});
+        target.AdvanceTo(std::chrono::milliseconds{i});
+    }
+    // Номера снимков разных сессий не совпадают
+    const auto known = source.GetSnapshot()->tick;
+    const auto target_known = target.GetSnapshot()->tick;
+    CHECK(known != target_known);
+
+    target.AdoptDog(source.ReleaseDog(dog->GetId()));
+    target.AdvanceTo(4ms);
+    const auto current = target.GetSnapshot();
+    CHECK(current->tick > known);
+    // Номер из истории прежней сессии не относится к новой: клиенту нужно полное состояние
+    CHECK_FALSE(current->DeltaSince(known));
+    // Клиент, давно играющий в этой сессии, по-прежнему получает разницу
+    const auto delta = current->DeltaSince(target_known);
+    REQUIRE(delta);
+    REQUIRE(delta->changed_dogs.size() == 1);
+    CHECK(delta->changed_dogs.front()->dog_id == dog->GetId());
+}
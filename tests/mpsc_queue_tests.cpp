@@ -0,0 +1,80 @@
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mpsc_queue.h"
+
+namespace {
+
+const std::string TAG = "[BoundedMpscQueue]";
+
+}  // namespace
+
+TEST_CASE("Bounded queue keeps order and refuses values when full", TAG) {
+    util::BoundedMpscQueue<int> queue{4};
+    CHECK(queue.Empty());
+    for (int i = 0; i < 4; ++i) {
+        CHECK(queue.TryPush(i));
+    }
+    CHECK_FALSE(queue.TryPush(4));
+    CHECK_FALSE(queue.Empty());
+
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPop(value));
+        CHECK(value == i);
+    }
+    CHECK_FALSE(queue.TryPop(value));
+    CHECK(queue.Empty());
+
+    // Освободившиеся ячейки используются на следующем круге
+    CHECK(queue.TryPush(5));
+    REQUIRE(queue.TryPop(value));
+    CHECK(value == 5);
+}
+
+TEST_CASE("Bounded queue capacity must be a power of two", TAG) {
+    CHECK_THROWS_AS(util::BoundedMpscQueue<int>{3}, std::invalid_argument);
+    CHECK_THROWS_AS(util::BoundedMpscQueue<int>{0}, std::invalid_argument);
+    CHECK(util::BoundedMpscQueue<int>{8}.Capacity() == 8);
+}
+
+TEST_CASE("Bounded queue delivers every value from several producers", TAG) {
+    constexpr int PRODUCERS = 4;
+    constexpr int PER_PRODUCER = 20000;
+    util::BoundedMpscQueue<int> queue{64};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < PER_PRODUCER; ++i) {
+                while (!queue.TryPush(p * PER_PRODUCER + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Значения одного писателя приходят в порядке записи
+    std::vector<int> last(PRODUCERS, -1);
+    bool ordered = true;
+    int received = 0;
+    int value = 0;
+    while (received < PRODUCERS * PER_PRODUCER) {
+        if (!queue.TryPop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        const int producer = value / PER_PRODUCER;
+        ordered = ordered && value % PER_PRODUCER == last[producer] + 1;
+        last[producer] = value % PER_PRODUCER;
+        ++received;
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    CHECK(ordered);
+    CHECK(queue.Empty());
+}
@@ -0,0 +1,90 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+#include "slot_map.h"
+#include "tagged.h"
+
+using namespace std::literals;
+
+namespace {
+
+const std::string TAG = "[SlotMap]";
+
+using Key = util::Tagged<uint32_t, struct KeyTag>;
+using Map = util::SlotMap<Key, std::string>;
+
+}  // namespace
+
+TEST_CASE("Slot map finds inserted values by key", TAG) {
+    Map map;
+    CHECK(map.NextKey() == Key{0u});
+    const auto a = map.Insert("a"s);
+    const auto b = map.Insert("b"s);
+    CHECK(a == Key{0u});
+    CHECK(b == Key{1u});
+    CHECK(map.Size() == 2);
+    REQUIRE(map.Find(a) != nullptr);
+    CHECK(*map.Find(a) == "a"s);
+    CHECK(*map.Find(b) == "b"s);
+}
+
+TEST_CASE("Erased key does not find a value reusing its slot", TAG) {
+    Map map;
+    const auto a = map.Insert("a"s);
+    const auto b = map.Insert("b"s);
+    CHECK(map.Erase(a));
+    CHECK_FALSE(map.Erase(a));
+    CHECK_FALSE(map.Contains(a));
+    // Последнее значение переехало на место удалённого, ключ остался прежним
+    CHECK(*map.Find(b) == "b"s);
+    CHECK(map.Values().size() == 1);
+    CHECK(map.Keys()[0] == b);
+
+    const auto c = map.Insert("c"s);
+    CHECK(c != a);
+    CHECK((*c & (Map::MAX_SLOTS - 1)) == (*a & (Map::MAX_SLOTS - 1)));
+    CHECK(map.Find(a) == nullptr);
+    CHECK(*map.Find(c) == "c"s);
+}
+
+TEST_CASE("Slot map restores values under their keys", TAG) {
+    Map source;
+    std::vector<Key> keys;
+    for (int i = 0; i < 5; ++i) {
+        keys.push_back(source.Insert(std::to_string(i)));
+    }
+    source.Erase(keys[1]);
+    source.Erase(keys[3]);
+    keys.push_back(source.Insert("5"s));
+
+    Map restored;
+    for (size_t i = 0; i < source.Size(); ++i) {
+        restored.InsertAt(source.Keys()[i], source.Values()[i]);
+    }
+    CHECK_THROWS_AS(restored.InsertAt(source.Keys()[0], "x"s), std::invalid_argument);
+    for (auto key : source.Keys()) {
+        REQUIRE(restored.Contains(key));
+        CHECK(*restored.Find(key) == *source.Find(key));
+    }
+    // Новые ключи не совпадают с восстановленными
+    const auto fresh = restored.Insert("6"s);
+    for (auto key : source.Keys()) {
+        CHECK(fresh != key);
+    }
+    CHECK(restored.Size() == source.Size() + 1);
+}
+
+TEST_CASE("Slot map erases values matching a predicate", TAG) {
+    Map map;
+    for (int i = 0; i < 10; ++i) {
+        map.Insert(std::to_string(i));
+    }
+    CHECK(map.EraseIf([](const std::string& value) {
+        return (value[0] - '0') % 2 == 0;
+    }) == 5);
+    CHECK(map.Size() == 5);
+    for (size_t i = 0; i < map.Size(); ++i) {
+        CHECK((map.Values()[i][0] - '0') % 2 == 1);
+        CHECK(*map.Find(map.Keys()[i]) == map.Values()[i]);
+    }
+}
@@ -0,0 +1,241 @@
+#include <catch2/catch_test_macros.hpp>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tick_coordinator.h"
+
+using namespace std::literals;
+using namespace model;
+
+namespace {
+
+const std::string TAG = "[TickCoordinator]";
+
+std::shared_ptr<Map> MakeMap(size_t bag_capacity = 3) {
+    Map map{Map::Id{"map"s}, "map"s, 1.0, bag_capacity};
+    map.AddRoad(Road{Road::HORIZONTAL, Point{0, 0}, 10});
+    map.AddLootType(LootType{});
+    map.BuildRoadIndex();
+    return std::make_shared<Map>(std::move(map));
+}
+
+}  // namespace
+
+TEST_CASE("Tick coordinator advances all sessions in one batch", TAG) {
+    constexpr size_t SESSIONS = 16;
+    constexpr auto STEP = 50ms;
+
+    net::io_context ioc;
+    auto work = net::make_work_guard(ioc);
+    net::thread_pool gather_pool{1};
+    const auto map = MakeMap();
+
+    auto coordinator = std::make_shared<TickCoordinator>(ioc, std::nullopt);
+    std::vector<std::shared_ptr<GameSession>> sessions;
+    for (uint32_t i = 0; i < SESSIONS; ++i) {
+        sessions.push_back(std::make_shared<GameSession>(GameSession::Id{i}, map, LootGeneratorConfig{1.0, 0.5}, ioc,
+                                                         STEP, gather_pool));
+        coordinator->AddSession(sessions.back());
+        // Бегущий пёс не даёт сессии уснуть
+        const auto dog = sessions.back()->AddDog("dog"s, {0, 0});
+        sessions.back()->SetDogDirection(dog->GetId(), Direction::EAST);
+    }
+
+    std::promise<void> done;
+    std::chrono::milliseconds total{0};
+    bool consistent = true;
+    coordinator->SetBatchHandler([&](std::chrono::milliseconds delta) {
+        total += delta;
+        // Обработчик вызывается между партиями: все сессии уже отработали всё время
+        for (const auto& session : sessions) {
+            consistent = consistent && session->GetTimestepStats()->steps == static_cast<uint64_t>(total / STEP);
+        }
+        if (total == 300ms) {
+            done.set_value();
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; ++i) {
+        workers.emplace_back([&ioc] {
+            ioc.run();
+        });
+    }
+    for (int i = 0; i < 3; ++i) {
+        coordinator->Tick(100ms);
+    }
+    const auto status = done.get_future().wait_for(10s);
+    work.reset();
+    ioc.stop();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    REQUIRE(status == std::future_status::ready);
+    CHECK(consistent);
+    for (const auto& session : sessions) {
+        CHECK(session->GetTimestepStats()->steps == 6);
+    }
+}
+
+TEST_CASE("Removed session is not advanced", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    const auto map = MakeMap();
+
+    auto coordinator = std::make_shared<TickCoordinator>(ioc, std::nullopt);
+    auto kept = std::make_shared<GameSession>(GameSession::Id{0u}, map, LootGeneratorConfig{1.0, 0.5}, ioc, 50ms,
+                                              gather_pool);
+    auto removed = std::make_shared<GameSession>(GameSession::Id{1u}, map, LootGeneratorConfig{1.0, 0.5}, ioc, 50ms,
+                                                 gather_pool);
+    coordinator->AddSession(kept);
+    coordinator->AddSession(removed);
+    coordinator->RemoveSession(removed->GetId());
+
+    size_t batches = 0;
+    coordinator->SetBatchHandler([&batches](std::chrono::milliseconds) {
+        ++batches;
+    });
+    coordinator->Tick(50ms);
+    ioc.run();
+
+    CHECK(batches == 1);
+    CHECK(kept->GetTimestepStats()->steps == 1);
+    CHECK(removed->GetTimestepStats()->steps == 0);
+}
+
+TEST_CASE("Batch handler holds the next batch until its work is done", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    auto coordinator = std::make_shared<TickCoordinator>(ioc, std::nullopt);
+    auto session = std::make_shared<GameSession>(GameSession::Id{0u}, MakeMap(), LootGeneratorConfig{1.0, 0.5}, ioc,
+                                                 50ms, gather_pool);
+    coordinator->AddSession(session);
+    const auto dog = session->AddDog("dog"s, {0, 0});
+    session->SetDogDirection(dog->GetId(), Direction::EAST);
+
+    std::function<void()> release;
+    std::vector<std::chrono::milliseconds> batches;
+    coordinator->SetBatchHandler([&](std::chrono::milliseconds delta) {
+        batches.push_back(delta);
+        if (batches.size() == 1) {
+            release = coordinator->HoldNextBatch();
+        }
+    });
+
+    coordinator->Tick(50ms);
+    ioc.run();
+    coordinator->Tick(50ms);
+    coordinator->Tick(50ms);
+    ioc.restart();
+    ioc.run();
+    // Пока отсрочка не снята, время копится, а сессия стоит
+    CHECK(batches.size() == 1);
+    CHECK(session->GetTimestepStats()->steps == 1);
+
+    release();
+    ioc.restart();
+    ioc.run();
+    REQUIRE(batches.size() == 2);
+    CHECK(batches.back() == 100ms);
+    CHECK(session->GetTimestepStats()->steps == 3);
+}
+
+TEST_CASE("Session without moving dogs hibernates until retirement", TAG) {
+    Dog::SetMaxInactiveTime(1);
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    auto coordinator = std::make_shared<TickCoordinator>(ioc, std::nullopt);
+    auto session = std::make_shared<GameSession>(GameSession::Id{0u}, MakeMap(), LootGeneratorConfig{1.0, 0.5}, ioc,
+                                                 50ms, gather_pool);
+    coordinator->AddSession(session);
+    session->AddDog("dog"s, {0, 0});
+    // На каждого пса уже есть предмет, и генератору нечего добавлять
+    session->AddLostObject(0, {5, 0}, 1);
+    std::vector<PlayerRecord> records;
+    session->AddHandlingFinishedPlayersEvent([&records](const std::vector<PlayerRecord>& finished) {
+        records.insert(records.end(), finished.begin(), finished.end());
+    });
+
+    const auto tick = [&] {
+        coordinator->Tick(100ms);
+        ioc.restart();
+        ioc.run();
+    };
+
+    // Новый пёс проходит один тик среди движущихся, потом сессия засыпает
+    tick();
+    CHECK(session->IsHibernating(200ms));
+    const auto steps = session->GetTimestepStats()->steps;
+    for (int i = 0; i < 8; ++i) {
+        tick();
+    }
+    CHECK(session->GetTimestepStats()->steps == steps);
+    CHECK(session->GetDogs().Size() == 1);
+    CHECK_FALSE(session->IsHibernating(1000ms));
+
+    // Срок ухода наступил: сессия просыпается и отпускает пса
+    tick();
+    CHECK(session->GetDogs().Empty());
+    REQUIRE(records.size() == 1);
+    CHECK(records.front().GetPlayTime() == 1);
+    Dog::SetMaxInactiveTime(60);
+}
+
+TEST_CASE("Player command wakes hibernating session", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    auto coordinator = std::make_shared<TickCoordinator>(ioc, std::nullopt);
+    auto session = std::make_shared<GameSession>(GameSession::Id{0u}, MakeMap(), LootGeneratorConfig{1.0, 0.5}, ioc,
+                                                 50ms, gather_pool);
+    coordinator->AddSession(session);
+    const auto dog = session->AddDog("dog"s, {0, 0});
+    session->AddLostObject(0, {5, 0}, 1);
+
+    const auto tick = [&] {
+        coordinator->Tick(100ms);
+        ioc.restart();
+        ioc.run();
+    };
+    for (int i = 0; i < 5; ++i) {
+        tick();
+    }
+    REQUIRE(session->IsHibernating(500ms));
+
+    REQUIRE(session->PushCommand(dog->GetId(), Direction::EAST));
+    CHECK_FALSE(session->IsHibernating(500ms));
+    tick();
+    // Команда применяется в начале последнего шага, время сна на путь пса не влияет
+    CHECK(dog->GetPosition().x == 0.05);
+}
+
+TEST_CASE("Hibernation does not delay generated loot", TAG) {
+    net::io_context ioc;
+    net::thread_pool gather_pool{1};
+    auto coordinator = std::make_shared<TickCoordinator>(ioc, std::nullopt);
+    // Пёс с рюкзаком нулевой вместимости не подбирает предметы, и их число зависит только от генератора
+    auto sleeping = std::make_shared<GameSession>(GameSession::Id{0u}, MakeMap(0), LootGeneratorConfig{1.0, 0.5},
+                                                  ioc, 50ms, gather_pool);
+    coordinator->AddSession(sleeping);
+    sleeping->AddDog("dog"s, {0, 0});
+    // Сессия без часов не засыпает
+    GameSession awake{GameSession::Id{1u}, MakeMap(0), LootGeneratorConfig{1.0, 0.5}, ioc, 50ms, gather_pool};
+    awake.AddDog("dog"s, {0, 0});
+
+    bool slept = false;
+    auto now = 0ms;
+    for (int i = 0; i < 40; ++i) {
+        coordinator->Tick(100ms);
+        ioc.restart();
+        ioc.run();
+        now += 100ms;
+        awake.AdvanceTo(now);
+        slept = slept || sleeping->IsHibernating(now + 50ms);
+        CHECK(sleeping->GetLostObjects().Size() == awake.GetLostObjects().Size());
+    }
+    CHECK(awake.GetLostObjects().Size() == 1);
+    CHECK(slept);
+}
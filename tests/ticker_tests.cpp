@@ -0,0 +1,53 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+#include "ticker.h"
+
+using namespace std::literals;
+
+namespace {
+
+const std::string TAG = "[FixedTimestep]";
+
+}  // namespace
+
+TEST_CASE("Fixed timestep runs one step per period", TAG) {
+    FixedTimestep timestep{50ms, 5};
+    CHECK(timestep.Advance(30ms) == 0);
+    CHECK(timestep.Advance(30ms) == 1);
+    CHECK(timestep.Advance(40ms) == 1);
+    CHECK(timestep.Advance(50ms) == 1);
+    const auto stats = timestep.GetStats();
+    CHECK(stats.steps == 3);
+    CHECK(stats.late == 0);
+    CHECK(stats.skipped == 0);
+}
+
+TEST_CASE("Fixed timestep catches up with real time", TAG) {
+    FixedTimestep timestep{50ms, 5};
+    // Таймер опоздал на два периода: выполняем пропущенные шаги сразу
+    CHECK(timestep.Advance(170ms) == 3);
+    CHECK(timestep.Advance(30ms) == 1);
+    const auto stats = timestep.GetStats();
+    CHECK(stats.steps == 4);
+    CHECK(stats.late == 2);
+    CHECK(stats.skipped == 0);
+}
+
+TEST_CASE("Fixed timestep drops steps beyond the catch-up limit", TAG) {
+    FixedTimestep timestep{50ms, 3};
+    CHECK(timestep.Advance(1020ms) == 3);
+    auto stats = timestep.GetStats();
+    CHECK(stats.late == 2);
+    CHECK(stats.skipped == 17);
+    // Остаток меньше шага сохраняется, отброшенное время не возвращается
+    CHECK(timestep.Advance(30ms) == 1);
+    CHECK(timestep.Advance(40ms) == 0);
+    stats = timestep.GetStats();
+    CHECK(stats.steps == 4);
+}
+
+TEST_CASE("Fixed timestep rejects invalid parameters", TAG) {
+    CHECK_THROWS_AS((FixedTimestep{0ms, 5}), std::invalid_argument);
+    CHECK_THROWS_AS((FixedTimestep{50ms, 0}), std::invalid_argument);
+}